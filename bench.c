@@ -0,0 +1,395 @@
+#include "parser.h"
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Benchmark suite: every corpus is generated, written to a file and run
+// through each phase on its own. Results go to stdout as one JSON object
+// per line so runs can be diffed or loaded elsewhere:
+//
+//     ./bench            all corpora
+//     ./bench numbers    just one
+//
+// Each corpus runs in a child process so peak_rss_kb is its own. Timings
+// are the best of BENCH_REPEAT runs. parse_json starts from tokenize's
+// tokens; load_arena is a whole jsonStringLoadArena, lexing included.
+// Allocation counts need the --wrap=malloc/calloc/realloc link flags
+// `nob bench` passes, otherwise they are reported as -1.
+#ifndef BENCH_REPEAT
+    #define BENCH_REPEAT 5
+#endif
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+static size_t bench_allocations;
+static size_t bench_allocated_bytes;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    bench_allocations++;
+    bench_allocated_bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    bench_allocations++;
+    bench_allocated_bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size)
+{
+    bench_allocations++;
+    bench_allocated_bytes += size;
+    return __real_realloc(pointer, size);
+}
+#endif
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    double seconds;     // best run
+    long allocations;   // of the last run, -1 when not counted
+    long allocated_bytes;
+} Phase;
+
+static void phase_start(double* start)
+{
+#ifdef BENCH_COUNT_ALLOCATIONS
+    bench_allocations = 0;
+    bench_allocated_bytes = 0;
+#endif
+    *start = now_seconds();
+}
+
+static void phase_stop(Phase* phase, double start)
+{
+    double elapsed = now_seconds() - start;
+    if (phase->seconds == 0 || elapsed < phase->seconds) phase->seconds = elapsed;
+#ifdef BENCH_COUNT_ALLOCATIONS
+    phase->allocations = (long)bench_allocations;
+    phase->allocated_bytes = (long)bench_allocated_bytes;
+#else
+    phase->allocations = -1;
+    phase->allocated_bytes = -1;
+#endif
+}
+
+static void report(const char* corpus, const char* phase_name, const Phase* phase, size_t bytes, size_t nodes)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("{\"corpus\":\"%s\",\"phase\":\"%s\",\"bytes\":%zu,\"nodes\":%zu,\"ms\":%.3f,"
+           "\"mb_per_s\":%.1f,\"ns_per_node\":%.2f,\"allocations\":%ld,\"allocated_bytes\":%ld,"
+           "\"peak_rss_kb\":%ld}\n",
+           corpus, phase_name, bytes, nodes, phase->seconds * 1e3,
+           (double)bytes / (1024.0 * 1024.0) / phase->seconds, phase->seconds * 1e9 / (double)nodes,
+           phase->allocations, phase->allocated_bytes, usage.ru_maxrss);
+    fflush(stdout);
+}
+
+static size_t count_nodes(const JsonValue* json)
+{
+    size_t count = 1;
+    if (json->type == JSON_ARRAY) {
+        for (size_t i = 0; i < arrlenu(json->array); i++) count += count_nodes(json->array[i]);
+    } else if (json->type == JSON_OBJECT) {
+        for (size_t i = 0; i < json_length(json); i++) count += count_nodes(json->object->pairs[i].value);
+    }
+    return count;
+}
+
+static void append(char** out, const char* text, int n)
+{
+    memcpy(arraddnptr(*out, n), text, n);
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Array of small records, roughly what our API payloads look like
+static char* make_records(void)
+{
+    char* out = NULL;
+    arrput(out, '[');
+    for (size_t i = 0; i < 100000; i++) {
+        char record[256];
+        int n = snprintf(record, sizeof(record),
+                         "%s{\"id\": %zu, \"name\": \"user_%zu\", \"score\": %zu.25, "
+                         "\"active\": %s, \"tags\": [\"a\", \"b\", \"c\"], \"parent\": null}",
+                         i ? "," : "", i, i, i % 1000, (i & 1) ? "true" : "false");
+        append(&out, record, n);
+    }
+    arrput(out, ']');
+    return out;
+}
+
+// Flat array of doubles with a spread of magnitudes and digit counts
+static char* make_numbers(void)
+{
+    char* out = NULL;
+    uint64_t state = 88172645463325252ULL;
+    arrput(out, '[');
+    for (size_t i = 0; i < 1000000; i++) {
+        uint64_t r = next_random(&state);
+        double value = (double)(r % 10000000) / (double)(1 + (r >> 40) % 1000);
+        if (i % 4 == 0) value *= 1e12;
+        char number[64];
+        int n = snprintf(number, sizeof(number), "%s%.17g", i ? "," : "", value);
+        append(&out, number, n);
+    }
+    arrput(out, ']');
+    return out;
+}
+
+// Strings of mixed length, a third of them with escapes and \u sequences
+static char* make_strings(void)
+{
+    static const char* pieces[] = {
+        "plain words ", "tab\\t", "quote\\\"", "back\\\\slash", "line\\n", "\\u00e9t\\u00e9 ",
+        "\\ud83d\\ude00", "caf\xc3\xa9 ", "a longer run of text without anything to escape ",
+    };
+    char* out = NULL;
+    uint64_t state = 2463534242ULL;
+    arrput(out, '[');
+    for (size_t i = 0; i < 200000; i++) {
+        if (i) arrput(out, ',');
+        arrput(out, '"');
+        size_t count = 1 + next_random(&state) % 6;
+        for (size_t j = 0; j < count; j++) {
+            size_t piece = i % 3 == 0 ? next_random(&state) % 9 : (j & 1 ? 0 : 8);
+            append(&out, pieces[piece], (int)strlen(pieces[piece]));
+        }
+        arrput(out, '"');
+    }
+    arrput(out, ']');
+    return out;
+}
+
+// Many documents nested 500 levels deep through objects and arrays
+static char* make_nested(void)
+{
+    char* out = NULL;
+    arrput(out, '[');
+    for (size_t i = 0; i < 400; i++) {
+        if (i) arrput(out, ',');
+        for (size_t depth = 0; depth < 500; depth++) {
+            if (depth & 1) append(&out, "[1,", 3);
+            else append(&out, "{\"k\":", 5);
+        }
+        append(&out, "null", 4);
+        for (size_t depth = 500; depth-- > 0;) {
+            arrput(out, depth & 1 ? ']' : '}');
+        }
+    }
+    arrput(out, ']');
+    return out;
+}
+
+// A few objects with tens of thousands of keys each
+static char* make_wide(void)
+{
+    char* out = NULL;
+    arrput(out, '[');
+    for (size_t i = 0; i < 8; i++) {
+        if (i) arrput(out, ',');
+        arrput(out, '{');
+        for (size_t key = 0; key < 40000; key++) {
+            char member[64];
+            int n = snprintf(member, sizeof(member), "%s\"field_%zu_%zu\":%zu", key ? "," : "", i, key, key);
+            append(&out, member, n);
+        }
+        arrput(out, '}');
+    }
+    arrput(out, ']');
+    return out;
+}
+
+// The records as newline-delimited JSON
+static char* make_ndjson(void)
+{
+    char* out = NULL;
+    for (size_t i = 0; i < 100000; i++) {
+        char record[256];
+        int n = snprintf(record, sizeof(record),
+                         "{\"id\": %zu, \"name\": \"user_%zu\", \"score\": %zu.25, "
+                         "\"active\": %s, \"tags\": [\"a\", \"b\", \"c\"], \"parent\": null}\n",
+                         i, i, i % 1000, (i & 1) ? "true" : "false");
+        append(&out, record, n);
+    }
+    return out;
+}
+
+static char* write_corpus(const char* name, char* content)
+{
+    static char path[256];
+    snprintf(path, sizeof(path), "/tmp/cjson_bench_%s_%d.json", name, (int)getpid());
+    FILE* fp = fopen(path, "wb");
+    if (!fp || fwrite(content, 1, arrlenu(content), fp) != arrlenu(content)) {
+        fprintf(stderr, "Could not write %s\n", path);
+        exit(1);
+    }
+    fclose(fp);
+    return path;
+}
+
+static void bench_document(const char* name, char* content)
+{
+    char* path = write_corpus(name, content);
+    size_t bytes = arrlenu(content);
+    Phase read = {0}, tokens = {0}, parse = {0}, arena = {0}, dump = {0}, print = {0}, release = {0};
+    size_t nodes = 0;
+    FILE* null_device = fopen("/dev/null", "wb");
+    JsonArena json_arena;
+    json_arena_init(&json_arena, 0);
+    double start;
+
+    for (int run = 0; run < BENCH_REPEAT; run++) {
+        phase_start(&start);
+        char* text = file_read(path);
+        phase_stop(&read, start);
+
+        phase_start(&start);
+        CjsonToken* token_array = tokenize(text);
+        phase_stop(&tokens, start);
+
+        JsonValue* json = malloc(sizeof(JsonValue));
+        phase_start(&start);
+        parse_json(token_array, json);
+        phase_stop(&parse, start);
+        if (!nodes) nodes = count_nodes(json);
+
+        JsonValue arena_json;
+        phase_start(&start);
+        jsonStringLoadArena(text, &arena_json, &json_arena);
+        json_arena_reset(&json_arena);
+        phase_stop(&arena, start);
+
+        phase_start(&start);
+        char* out = json_dump_string(json);
+        phase_stop(&dump, start);
+        free(out);
+
+        JsonWriter writer;
+        json_writer_init_file(&writer, null_device);
+        phase_start(&start);
+        json_write_pretty(&writer, json, 4, 0);
+        json_writer_flush(&writer);
+        phase_stop(&print, start);
+        json_writer_free(&writer);
+
+        phase_start(&start);
+        json_free(json);
+        phase_stop(&release, start);
+
+        arrfree(token_array);
+        arrfree(text);
+    }
+
+    report(name, "file_read", &read, bytes, nodes);
+    report(name, "tokenize", &tokens, bytes, nodes);
+    report(name, "parse_json", &parse, bytes, nodes);
+    report(name, "load_arena", &arena, bytes, nodes);
+    report(name, "json_dump", &dump, bytes, nodes);
+    report(name, "json_print", &print, bytes, nodes);
+    report(name, "json_free", &release, bytes, nodes);
+
+    json_arena_free(&json_arena);
+    fclose(null_device);
+    remove(path);
+}
+
+static void bench_ndjson(const char* name, char* content)
+{
+    char* path = write_corpus(name, content);
+    size_t bytes = arrlenu(content);
+    Phase read = {0}, parse = {0}, dump = {0}, release = {0};
+    size_t nodes = 0;
+    double start;
+
+    for (int run = 0; run < BENCH_REPEAT; run++) {
+        phase_start(&start);
+        char* text = file_read(path);
+        phase_stop(&read, start);
+
+        phase_start(&start);
+        JsonValue** records = json_ndjson_load(text, arrlenu(text) - 1, 1, NULL);
+        phase_stop(&parse, start);
+        if (!nodes) {
+            for (size_t i = 0; i < arrlenu(records); i++) nodes += count_nodes(records[i]);
+        }
+
+        phase_start(&start);
+        JsonWriter writer;
+        json_writer_init(&writer);
+        for (size_t i = 0; i < arrlenu(records); i++) {
+            json_write(&writer, records[i]);
+            cjson_writer_char(&writer, '\n');
+        }
+        phase_stop(&dump, start);
+        json_writer_free(&writer);
+
+        phase_start(&start);
+        for (size_t i = 0; i < arrlenu(records); i++) json_free(records[i]);
+        arrfree(records);
+        phase_stop(&release, start);
+
+        arrfree(text);
+    }
+
+    report(name, "file_read", &read, bytes, nodes);
+    report(name, "json_ndjson_load", &parse, bytes, nodes);
+    report(name, "json_dump", &dump, bytes, nodes);
+    report(name, "json_free", &release, bytes, nodes);
+    remove(path);
+}
+
+typedef struct {
+    const char* name;
+    char* (*make)(void);
+    void (*run)(const char* name, char* content);
+} Corpus;
+
+static const Corpus corpora[] = {
+    { "numbers", make_numbers, bench_document },
+    { "strings", make_strings, bench_document },
+    { "nested",  make_nested,  bench_document },
+    { "wide",    make_wide,    bench_document },
+    { "records", make_records, bench_document },
+    { "ndjson",  make_ndjson,  bench_ndjson },
+};
+
+int main(int argc, char** argv)
+{
+    for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+        if (argc > 1 && strcmp(argv[1], corpora[i].name) != 0) continue;
+        fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            char* content = corpora[i].make();
+            corpora[i].run(corpora[i].name, content);
+            arrfree(content);
+            exit(0);
+        }
+        int status = 0;
+        if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "corpus %s failed\n", corpora[i].name);
+            return 1;
+        }
+    }
+    return 0;
+}
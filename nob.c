@@ -7,7 +7,18 @@ int main(int argc, char **argv)
 
 	Nob_Cmd cmd = {0};
 
-	nob_cmd_append(&cmd, "gcc", "-Wall", "-Wextra", "-g", "-pedantic", "-o", "main", "main.c");
+	if(argc > 1 && strcmp(argv[1], "bench") == 0){
+		nob_cmd_append(&cmd, "gcc", "-Wall", "-Wextra", "-O2", "-pedantic", "-pthread", "-DBENCH_COUNT_ALLOCATIONS",
+		               "-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc", "-o", "bench", "bench.c");
+		if(!nob_cmd_run_sync_and_reset(&cmd)) return 1;
+		nob_cmd_append(&cmd, "./bench");
+		// `./nob bench numbers` runs a single corpus
+		if(argc > 2) nob_cmd_append(&cmd, argv[2]);
+		if(!nob_cmd_run_sync_and_reset(&cmd)) return 1;
+		return 0;
+	}
+
+	nob_cmd_append(&cmd, "gcc", "-Wall", "-Wextra", "-g", "-pedantic", "-pthread", "-o", "main", "main.c");
 	if(!nob_cmd_run_sync_and_reset(&cmd)) return 1;
 	nob_cmd_append(&cmd, "./main");
 	if(!nob_cmd_run_sync_and_reset(&cmd)) return 1;
@@ -2,6 +2,7 @@
 #define _H_CJSON
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
@@ -10,7 +11,31 @@
 #include <ctype.h>
 #include <math.h>
 #include <stdarg.h>
+#include <locale.h>
+#include <limits.h>
+#include <float.h>
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define CJSON_POSIX
+    #include <unistd.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#if defined(CJSON_POSIX) && !defined(CJSON_NO_THREADS)
+    #define CJSON_THREADS
+    #include <pthread.h>
+#endif
 
+// With CJSON_STATS, stb_ds growth goes through the allocation counter (see JsonStats)
+#if defined(CJSON_STATS) && !defined(STBDS_REALLOC)
+    static void* cjson_stats_realloc(void* ptr, size_t size);
+    #define STBDS_REALLOC(context, ptr, size) cjson_stats_realloc((ptr), (size))
+    #define STBDS_FREE(context, ptr) free(ptr)
+#endif
 
 #ifndef CJSON_NO_STB_DS
     #define STB_DS_IMPLEMENTATION
@@ -63,6 +88,78 @@ char* file_read(const char* file_name) {
     return content;
 }
 
+// File contents ready for the lexer: data[length] is always '\0'. On POSIX
+// systems the pages are mapped privately instead of copied, so writes
+// (in-situ parsing) never reach the file.
+typedef struct {
+    char* data;
+    size_t length;
+    size_t mapped_length; // 0 when data is a file_read array
+} JsonMappedFile;
+
+bool json_file_map(const char* file_name, JsonMappedFile* file) {
+    file->data = NULL;
+    file->length = 0;
+    file->mapped_length = 0;
+
+#if defined(CJSON_POSIX) && defined(MAP_ANONYMOUS)
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not read file\n");
+        return false;
+    }
+
+    struct stat st;
+    // empty and special files have nothing to map, file_read handles those
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t length = (size_t)st.st_size;
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+        // The kernel zero-fills the rest of the last page, which gives us the
+        // terminator for free. A file ending exactly on a page boundary gets an
+        // extra anonymous zero page behind it instead.
+        size_t mapped_length = length % page ? length : length + page;
+        char* data = mmap(NULL, mapped_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data != MAP_FAILED) {
+            if (mmap(data, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                close(fd);
+#ifdef MADV_WILLNEED
+                // start readahead for the whole file so I/O overlaps with parsing
+                madvise(data, length, MADV_SEQUENTIAL);
+                madvise(data, length, MADV_WILLNEED);
+#endif
+                file->data = data;
+                file->length = length;
+                file->mapped_length = mapped_length;
+                return true;
+            }
+            munmap(data, mapped_length);
+        }
+    }
+    close(fd);
+#endif
+
+    char* content = file_read(file_name);
+    if (!content) return false;
+    file->data = content;
+    file->length = arrlenu(content) - 1;
+    return true;
+}
+
+void json_file_unmap(JsonMappedFile* file) {
+#ifdef CJSON_POSIX
+    if (file->mapped_length) {
+        munmap(file->data, file->mapped_length);
+    } else
+#endif
+    {
+        arrfree(file->data);
+    }
+    file->data = NULL;
+    file->length = 0;
+    file->mapped_length = 0;
+}
+
 typedef enum {
     TOKEN_EOF=0, TOKEN_ERROR, TOKEN_LEFT_BRACE, TOKEN_RIGHT_BRACE,
     TOKEN_LEFT_BRACKET, TOKEN_RIGHT_BRACKET,
@@ -98,24 +195,545 @@ typedef struct {
     size_t length;
 } CjsonToken;
 
-static int utf8_char_len(uint8_t c) {
-    if (c < 0x80) return 1;              // ASCII
-    else if ((c & 0xE0) == 0xC0) return 2; // 110xxxxx
-    else if ((c & 0xF0) == 0xE0) return 3; // 1110xxxx
-    else if ((c & 0xF8) == 0xF0) return 4; // 11110xxx
-    else return 1;
+typedef enum {
+    JSON_OK = 0,
+    JSON_ERROR_SYNTAX,      // token out of place, or text that is no JSON token
+    JSON_ERROR_STRING,      // malformed escape sequence
+    JSON_ERROR_NUMBER,      // number that breaks the RFC 8259 grammar
+    JSON_ERROR_INCOMPLETE,  // input ended inside a value
+    JSON_ERROR_TRAILING,    // more input after the root value
+    JSON_ERROR_CANCELLED,   // a callback asked to stop
+    JSON_ERROR_TYPE,        // value doesn't fit the struct field it is bound to
+    JSON_ERROR_UTF8,        // string bytes that are not well-formed UTF-8
+    JSON_ERROR_TOO_LARGE,   // document past the size a format can address
+    JSON_ERROR_DEPTH,       // well-formed so far, but nested past the configured limit
+} JsonErrorCode;
+
+// Reported by the parsers that return instead of exiting
+typedef struct {
+    JsonErrorCode code;
+    size_t offset;       // byte offset into the whole input
+    const char* message; // static string, never freed
+} JsonError;
+
+// Instrumentation, compiled out unless CJSON_STATS is defined. With it,
+// tokenize, the DOM parsers, json_dump and json_free add into a per-thread
+// JsonStats (parallel parse workers count on their own threads); without
+// it every hook is empty and json_stats() stays zeroed. Allocations are
+// node, string and object mallocs, arena blocks and stb_ds growth, where a
+// realloc counts once with its new size. Streaming parsers tokenize as
+// they go, so their lexing time is part of parse_ns.
+typedef struct {
+    uint64_t bytes;                      // input consumed by the lexer
+    uint64_t tokens[TOKEN_NOT_INIT + 1]; // by JsonTokenType
+    uint64_t nodes[JSON_OBJECT + 1];     // by JsonType
+    size_t max_depth;
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    uint64_t output_bytes;               // produced by json_dump/json_dump_string
+    uint64_t tokenize_ns;
+    uint64_t parse_ns;
+    uint64_t dump_ns;
+    uint64_t free_ns;
+} JsonStats;
+
+static _Thread_local JsonStats cjson_stats_state;
+
+// This thread's counters since the last json_stats_reset
+const JsonStats* json_stats(void){
+    return &cjson_stats_state;
+}
+
+void json_stats_reset(void){
+    memset(&cjson_stats_state, 0, sizeof(cjson_stats_state));
+}
+
+#ifdef CJSON_STATS
+    #define CJSON_STAT(statement) do { statement; } while (0)
+    #define CJSON_STAT_START(name) uint64_t name = cjson_stats_now()
+    #define CJSON_STAT_STOP(name, phase) CJSON_STAT(cjson_stats_state.phase += cjson_stats_now() - (name))
+    #define CJSON_STAT_ALLOC(size) CJSON_STAT(cjson_stats_state.allocations++; cjson_stats_state.allocated_bytes += (size))
+
+static _Thread_local size_t cjson_stats_depth;
+
+static uint64_t cjson_stats_now(void){
+    struct timespec now;
+#ifdef CJSON_POSIX
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+    timespec_get(&now, TIME_UTC);
+#endif
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static void* cjson_stats_realloc(void* ptr, size_t size){
+    CJSON_STAT_ALLOC(size);
+    return realloc(ptr, size);
+}
+
+static inline void cjson_stats_enter(void){
+    if(++cjson_stats_depth > cjson_stats_state.max_depth){
+        cjson_stats_state.max_depth = cjson_stats_depth;
+    }
+}
+
+static inline void cjson_stats_leave(void){
+    cjson_stats_depth--;
+}
+#else
+    #define CJSON_STAT(statement) ((void)0)
+    #define CJSON_STAT_START(name) ((void)0)
+    #define CJSON_STAT_STOP(name, phase) ((void)0)
+    #define CJSON_STAT_ALLOC(size) ((void)0)
+#endif
+
+// SIMD helpers. SSE2 is part of x86-64, AVX2 is picked at runtime and
+// everything else falls back to scalar loops. Define CJSON_NO_SIMD to force
+// the scalar paths.
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(CJSON_NO_SIMD)
+    #define CJSON_X86_SIMD
+    #include <immintrin.h>
+    #define CJSON_TARGET_AVX2 __attribute__((target("avx2")))
+    // vector loads may touch bytes past the terminator, but never past its aligned block
+    #define CJSON_NO_ASAN __attribute__((no_sanitize_address))
+#endif
+
+static inline int cjson_ctz64(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; n++; }
+    return n;
+#endif
+}
+
+#ifdef CJSON_X86_SIMD
+static bool cjson_cpu_has_avx2(void) {
+    static int has_avx2 = -1;
+    int cached = __atomic_load_n(&has_avx2, __ATOMIC_RELAXED);
+    if (cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&has_avx2, cached, __ATOMIC_RELAXED);
+    }
+    return cached;
+}
+#endif
+
+#ifndef CJSON_X86_SIMD
+// Returns the index of the first '"', '\\' or NUL at or after index
+static size_t cjson_scan_string_scalar(const char* json, size_t index) {
+    while (json[index] != '"' && json[index] != '\\' && json[index] != '\0') {
+        index++;
+    }
+    return index;
+}
+#else
+CJSON_NO_ASAN static size_t cjson_scan_string_sse2(const char* json, size_t index) {
+    const char* p = json + index;
+    size_t misalign = (uintptr_t)p & 15;
+    const __m128i* block = (const __m128i*)(p - misalign);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i v = _mm_load_si128(block);
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+        _mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), _mm_cmpeq_epi8(v, zero)));
+    mask >>= misalign;
+    if (mask) return index + cjson_ctz64(mask);
+    index += 16 - misalign;
+
+    while (true) {
+        v = _mm_load_si128(++block);
+        mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+            _mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), _mm_cmpeq_epi8(v, zero)));
+        if (mask) return index + cjson_ctz64(mask);
+        index += 16;
+    }
+}
+
+CJSON_NO_ASAN CJSON_TARGET_AVX2 static size_t cjson_scan_string_avx2(const char* json, size_t index) {
+    const char* p = json + index;
+    size_t misalign = (uintptr_t)p & 31;
+    const __m256i* block = (const __m256i*)(p - misalign);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i v = _mm256_load_si256(block);
+    uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+        _mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)), _mm256_cmpeq_epi8(v, zero)));
+    mask >>= misalign;
+    if (mask) return index + cjson_ctz64(mask);
+    index += 32 - misalign;
+
+    while (true) {
+        v = _mm256_load_si256(++block);
+        mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+            _mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)), _mm256_cmpeq_epi8(v, zero)));
+        if (mask) return index + cjson_ctz64(mask);
+        index += 32;
+    }
+}
+#endif
+
+static size_t cjson_scan_string(const char* json, size_t index) {
+#ifdef CJSON_X86_SIMD
+    if (cjson_cpu_has_avx2()) return cjson_scan_string_avx2(json, index);
+    return cjson_scan_string_sse2(json, index);
+#else
+    return cjson_scan_string_scalar(json, index);
+#endif
+}
+
+// Escape handling. The kernels below find the next byte that needs work
+// 16 or 32 bytes at a time; runs in between are copied with memcpy.
+#ifndef CJSON_X86_SIMD
+// First '\\' in [index, length), or length
+static size_t cjson_find_backslash(const char* str, size_t index, size_t length) {
+    const char* found = memchr(str + index, '\\', length - index);
+    return found ? (size_t)(found - str) : length;
+}
+
+// First byte in [index, length) that can't appear raw in a JSON string, or length
+static size_t cjson_find_escape_char(const char* str, size_t index, size_t length) {
+    while (index < length) {
+        uint8_t c = (uint8_t)str[index];
+        if (c == '"' || c == '\\' || c < 0x20) break;
+        index++;
+    }
+    return index;
+}
+#else
+static size_t cjson_find_backslash_sse2(const char* str, size_t index, size_t length) {
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; index + 16 <= length; index += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(str + index));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash));
+        if (mask) return index + cjson_ctz64(mask);
+    }
+    while (index < length && str[index] != '\\') index++;
+    return index;
+}
+
+CJSON_TARGET_AVX2 static size_t cjson_find_backslash_avx2(const char* str, size_t index, size_t length) {
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    for (; index + 32 <= length; index += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(str + index));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash));
+        if (mask) return index + cjson_ctz64(mask);
+    }
+    return cjson_find_backslash_sse2(str, index, length);
+}
+
+static size_t cjson_find_escape_char_sse2(const char* str, size_t index, size_t length) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    for (; index + 16 <= length; index += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(str + index));
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(v, control_max), control_max); // v <= 0x1F unsigned
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), control);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+        if (mask) return index + cjson_ctz64(mask);
+    }
+    while (index < length) {
+        uint8_t c = (uint8_t)str[index];
+        if (c == '"' || c == '\\' || c < 0x20) break;
+        index++;
+    }
+    return index;
+}
+
+CJSON_TARGET_AVX2 static size_t cjson_find_escape_char_avx2(const char* str, size_t index, size_t length) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control_max = _mm256_set1_epi8(0x1F);
+    for (; index + 32 <= length; index += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(str + index));
+        __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(v, control_max), control_max);
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)), control);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+        if (mask) return index + cjson_ctz64(mask);
+    }
+    return cjson_find_escape_char_sse2(str, index, length);
+}
+
+static size_t cjson_find_backslash(const char* str, size_t index, size_t length) {
+    if (cjson_cpu_has_avx2()) return cjson_find_backslash_avx2(str, index, length);
+    return cjson_find_backslash_sse2(str, index, length);
+}
+
+static size_t cjson_find_escape_char(const char* str, size_t index, size_t length) {
+    if (cjson_cpu_has_avx2()) return cjson_find_escape_char_avx2(str, index, length);
+    return cjson_find_escape_char_sse2(str, index, length);
+}
+#endif
+
+static int cjson_hex4(const char* hex) {
+    int value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = hex[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return -1;
+    }
+    return value;
+}
+
+static size_t cjson_utf8_encode(uint32_t code_point, char* out) {
+    if (code_point < 0x80) {
+        out[0] = (char)code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        out[0] = (char)(0xC0 | (code_point >> 6));
+        out[1] = (char)(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point < 0x10000) {
+        out[0] = (char)(0xE0 | (code_point >> 12));
+        out[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code_point >> 18));
+    out[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+// Decodes the body of a JSON string (no quotes) into dst, which needs room
+// for length bytes plus a NUL; decoding never grows, so dst may equal src.
+// Surrogate pairs become one 4-byte sequence, lone surrogates U+FFFD.
+// Returns false on an unknown escape or malformed \u sequence.
+static bool cjson_unescape(const char* src, size_t length, char* dst, size_t* out_length) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (true) {
+        size_t next = cjson_find_backslash(src, in, length);
+        if (next > in) {
+            memmove(dst + out, src + in, next - in);
+            out += next - in;
+        }
+        if (next >= length) break;
+
+        in = next + 1;
+        if (in >= length) return false;
+        switch (src[in++]) {
+            case '"':  dst[out++] = '"';  break;
+            case '\\': dst[out++] = '\\'; break;
+            case '/':  dst[out++] = '/';  break;
+            case 'b':  dst[out++] = '\b'; break;
+            case 'f':  dst[out++] = '\f'; break;
+            case 'n':  dst[out++] = '\n'; break;
+            case 'r':  dst[out++] = '\r'; break;
+            case 't':  dst[out++] = '\t'; break;
+            case 'u': {
+                if (length - in < 4) return false;
+                int unit = cjson_hex4(src + in);
+                if (unit < 0) return false;
+                in += 4;
+
+                uint32_t code_point = (uint32_t)unit;
+                if (unit >= 0xD800 && unit <= 0xDBFF) {
+                    int low = -1;
+                    if (length - in >= 6 && src[in] == '\\' && src[in + 1] == 'u') {
+                        low = cjson_hex4(src + in + 2);
+                    }
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        code_point = 0x10000 + (((uint32_t)unit - 0xD800) << 10) + ((uint32_t)low - 0xDC00);
+                        in += 6;
+                    } else {
+                        code_point = 0xFFFD;
+                    }
+                } else if (unit >= 0xDC00 && unit <= 0xDFFF) {
+                    code_point = 0xFFFD;
+                }
+                out += cjson_utf8_encode(code_point, dst + out);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    dst[out] = '\0';
+    *out_length = out;
+    return true;
+}
+
+// Stage 1 classifies 64 input bytes at a time into bitmaps, bit i = byte i
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;         // { } [ ] : ,
+    uint64_t whitespace;
+} CjsonBlockMasks;
+
+#ifndef CJSON_X86_SIMD
+static void cjson_classify_scalar(const uint8_t* block, CjsonBlockMasks* masks) {
+    masks->quote = masks->backslash = masks->op = masks->whitespace = 0;
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = (uint64_t)1 << i;
+        switch (block[i]) {
+            case '"':  masks->quote |= bit; break;
+            case '\\': masks->backslash |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                masks->op |= bit; break;
+            case ' ': case '\t': case '\n': case '\r':
+                masks->whitespace |= bit; break;
+        }
+    }
+}
+#else
+static void cjson_classify_sse2(const uint8_t* block, CjsonBlockMasks* masks) {
+    masks->quote = masks->backslash = masks->op = masks->whitespace = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('{')), _mm_cmpeq_epi8(v, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('[')), _mm_cmpeq_epi8(v, _mm_set1_epi8(']'))));
+        op = _mm_or_si128(op,
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        int shift = 16 * i;
+        masks->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << shift;
+        masks->backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << shift;
+        masks->op |= (uint64_t)(uint16_t)_mm_movemask_epi8(op) << shift;
+        masks->whitespace |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << shift;
+    }
+}
+
+CJSON_TARGET_AVX2 static void cjson_classify_avx2(const uint8_t* block, CjsonBlockMasks* masks) {
+    masks->quote = masks->backslash = masks->op = masks->whitespace = 0;
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(block + 32 * i));
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(']'))));
+        op = _mm256_or_si256(op,
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+        int shift = 32 * i;
+        masks->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << shift;
+        masks->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << shift;
+        masks->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << shift;
+        masks->whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << shift;
+    }
+}
+#endif
+
+static void cjson_classify_block(const uint8_t* block, CjsonBlockMasks* masks) {
+#ifdef CJSON_X86_SIMD
+    if (cjson_cpu_has_avx2()) cjson_classify_avx2(block, masks);
+    else cjson_classify_sse2(block, masks);
+#else
+    cjson_classify_scalar(block, masks);
+#endif
+}
+
+// Carries the string/escape state of one 64-byte block into the next
+typedef struct {
+    uint64_t prev_escaped;
+    uint64_t prev_in_string;      // all ones while inside a string
+    uint64_t prev_nonquote_scalar;
+} CjsonStage1State;
+
+static uint64_t cjson_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Bits of characters preceded by an odd run of backslashes
+static uint64_t cjson_find_escaped(uint64_t backslash, uint64_t* prev_escaped) {
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    backslash &= ~*prev_escaped;
+    uint64_t follows_escape = backslash << 1 | *prev_escaped;
+    uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+    uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    *prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts;
+    uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+// Structural characters outside strings, opening quotes and the first byte of every other scalar
+static uint64_t cjson_stage1_block(const uint8_t* block, CjsonStage1State* state) {
+    CjsonBlockMasks masks;
+    cjson_classify_block(block, &masks);
+
+    uint64_t escaped = cjson_find_escaped(masks.backslash, &state->prev_escaped);
+    uint64_t quote = masks.quote & ~escaped;
+    uint64_t in_string = cjson_prefix_xor(quote) ^ state->prev_in_string;
+    state->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+    uint64_t string_tail = in_string ^ quote;
+
+    uint64_t scalar = ~(masks.op | masks.whitespace);
+    uint64_t nonquote_scalar = scalar & ~quote;
+    uint64_t follows_nonquote_scalar = nonquote_scalar << 1 | state->prev_nonquote_scalar;
+    state->prev_nonquote_scalar = nonquote_scalar >> 63;
+    uint64_t scalar_start = scalar & ~follows_nonquote_scalar;
+
+    return (masks.op | scalar_start) & ~string_tail;
+}
+
+// Offsets of every token start in json, followed by length as an EOF sentinel.
+// Returns NULL for inputs of 4 GiB and more, which the offsets can't address.
+uint32_t* cjson_index_structurals(const char* json, size_t length) {
+    if (length >= UINT32_MAX) return NULL;
+
+    uint32_t* structurals = NULL;
+    arrsetcap(structurals, length / 4 + 64);
+    CjsonStage1State state = {0, 0, 0};
+
+    for (size_t offset = 0; offset < length; offset += 64) {
+        uint8_t padded[64];
+        const uint8_t* block = (const uint8_t*)json + offset;
+        if (length - offset < 64) {
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, length - offset);
+            block = padded;
+        }
+
+        uint64_t bits = cjson_stage1_block(block, &state);
+        uint32_t* out = arraddnptr(structurals, 64);
+        size_t count = 0;
+        while (bits) {
+            out[count++] = (uint32_t)(offset + cjson_ctz64(bits));
+            bits &= bits - 1;
+        }
+        arrsetlen(structurals, arrlenu(structurals) - 64 + count);
+    }
+
+    arrput(structurals, (uint32_t)length);
+    return structurals;
 }
 
 
 void cjson_parse_string(char* json, size_t* index, CjsonToken* tok) {
     size_t start = ++(*index);
 
-    while (json[*index] != '"' && json[*index] != '\0') {
+    while (true) {
+        *index = cjson_scan_string(json, *index);
         if (json[*index] == '\\' && json[*index + 1] != '\0') {
             (*index) += 2;
         } else {
-            int step = utf8_char_len((uint8_t)json[*index]);
-            (*index) += step;
+            break;
         }
     }
 
@@ -274,11 +892,13 @@ CjsonToken cjson_next_token(char* json, size_t* index) {
 
 
 CjsonToken* tokenize(char* file_content){
+    CJSON_STAT_START(start);
     CjsonToken* tokens = NULL;
     size_t index = 0;
 
     while (true) {
         CjsonToken tok = cjson_next_token(file_content, &index);
+        CJSON_STAT(cjson_stats_state.tokens[tok.type]++);
         if (tok.type == TOKEN_ERROR) {
             printf("Hit error at token %li. At file_content index %li\n",
                    (long int)arrlenu(tokens), (long int)index);
@@ -291,6 +911,8 @@ CjsonToken* tokenize(char* file_content){
         }
         arrput(tokens, tok);
     }
+    CJSON_STAT(cjson_stats_state.bytes += index);
+    CJSON_STAT_STOP(start, tokenize_ns);
     return tokens;
 }
 
@@ -301,646 +923,5618 @@ typedef struct {
     JsonValue *value;
 } JsonPair;
 
+// Members of an object, kept in insertion order in a dense pair array, so
+// iteration and serialization are a linear walk with a stable order. Small
+// objects are looked up by comparing keys in order; a hash index over the
+// pairs is built only when an object past CJSON_SMALL_OBJECT_MAX members
+// gets its first keyed lookup, and dropped again by removals. Because a
+// lookup may build the index, concurrent readers of one large object need
+// the index built first (any json_get_child will do). An empty object is a
+// NULL JsonObject*.
+#ifndef CJSON_SMALL_OBJECT_MAX
+    #define CJSON_SMALL_OBJECT_MAX 16
+#endif
+
+typedef struct {
+    JsonPair* pairs;    // stb_ds array, one per member
+    uint32_t* index;    // open addressing: pair index + 1, 0 when empty; NULL until needed
+    size_t capacity;    // index slot count, a power of two
+} JsonObject;
+
+// Set on JSON_NUMBER values whose exact integer doesn't fit a double. number
+// still holds the nearest double; the flag says the exact value is kept too.
+#define JSON_FLAG_INT64  0x01 // exact value in integer
+#define JSON_FLAG_UINT64 0x02 // exact value in uinteger, above INT64_MAX
+// In-situ parsing leaves strings and keys inside the caller's buffer
+#define JSON_FLAG_BORROWED     0x04 // string points into memory json_free must not release
+#define JSON_FLAG_KEY_BORROWED 0x08 // same for the key this value is stored under
+
 struct JsonValue {
     union {
-        double number;
+        double number;      // every JSON_NUMBER, rounded when a flag is set
         char *string;
         bool boolean;
         JsonValue** array;  // list of JsonValue
-        JsonPair* object;   // sh of JsonPair
+        JsonObject* object; // NULL when empty
+    };
+    union {                 // only meaningful with JSON_FLAG_INT64/UINT64
+        int64_t integer;
+        uint64_t uinteger;
     };
     JsonType type;
+    uint8_t flags;
+    uint32_t length; // byte length of JSON_STRING values, 0 means use strlen
 };
 
-typedef struct {
-    CjsonToken* tokens;
-    size_t index;
-} Parser;
-
+// Number conversion straight from the token span. Most numbers take
+// Clinger's exact fast path, the rest go through Eisel-Lemire with a
+// 128-bit power-of-five table; only ambiguous halfway cases and inputs
+// with more than 19 significant digits fall back to strtod.
+#define CJSON_SMALLEST_POWER_OF_TEN -325
+#define CJSON_LARGEST_POWER_OF_TEN 308
+
+// 5^q normalized to 128 bits, high word first, for q in [-325, 308]
+static const uint64_t cjson_power_of_five_128[][2] = {
+    {0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL}, {0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL},
+    {0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL}, {0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL},
+    {0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL}, {0xfd00b897478238d0ULL, 0x8920b098955522b4ULL},
+    {0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL}, {0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL},
+    {0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL}, {0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL},
+    {0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL}, {0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL},
+    {0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL}, {0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL},
+    {0xeba09271e88d976bULL, 0xf7864a44c633682eULL}, {0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL},
+    {0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL}, {0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL},
+    {0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL}, {0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL},
+    {0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL}, {0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL},
+    {0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL}, {0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL},
+    {0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL}, {0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL},
+    {0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL}, {0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL},
+    {0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL}, {0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL},
+    {0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL}, {0xa37fce126597973cULL, 0xe50ff107bab528a0ULL},
+    {0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL}, {0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL},
+    {0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL}, {0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL},
+    {0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL}, {0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL},
+    {0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL}, {0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL},
+    {0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL}, {0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL},
+    {0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL}, {0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL},
+    {0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL}, {0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL},
+    {0x91376c36d99995beULL, 0x23100809b9c21fa1ULL}, {0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL},
+    {0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL}, {0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL},
+    {0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL}, {0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL},
+    {0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL}, {0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL},
+    {0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL}, {0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL},
+    {0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL}, {0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL},
+    {0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL}, {0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL},
+    {0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL}, {0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL},
+    {0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL}, {0xc987434744ac874eULL, 0xa327ffb266b56220ULL},
+    {0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL}, {0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL},
+    {0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL}, {0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL},
+    {0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL}, {0xc0314325637a1939ULL, 0xfa911155fefb5308ULL},
+    {0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL}, {0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL},
+    {0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL}, {0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL},
+    {0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL}, {0xb749faed14125d36ULL, 0xcef980ec671f667bULL},
+    {0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL}, {0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL},
+    {0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL}, {0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL},
+    {0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL}, {0xaecc49914078536dULL, 0x58fae9f773886e18ULL},
+    {0xda7f5bf590966848ULL, 0xaf39a475506a899eULL}, {0x888f99797a5e012dULL, 0x6d8406c952429603ULL},
+    {0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL}, {0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL},
+    {0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL}, {0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL},
+    {0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL}, {0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL},
+    {0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL}, {0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL},
+    {0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL}, {0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL},
+    {0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL}, {0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL},
+    {0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL}, {0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL},
+    {0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL}, {0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL},
+    {0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL}, {0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL},
+    {0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL}, {0xb913179899f68584ULL, 0x28e2557b59846e3fULL},
+    {0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL}, {0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL},
+    {0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL}, {0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL},
+    {0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL}, {0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL},
+    {0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL}, {0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL},
+    {0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL}, {0xd77485cb25823ac7ULL, 0x7d633293366b828bULL},
+    {0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL}, {0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL},
+    {0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL}, {0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL},
+    {0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL}, {0xcd795be870516656ULL, 0x67902e276c921f8bULL},
+    {0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL}, {0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL},
+    {0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL}, {0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL},
+    {0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL}, {0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL},
+    {0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL}, {0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL},
+    {0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL}, {0xef340a98172aace4ULL, 0x86fb897116c87c34ULL},
+    {0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL}, {0xbae0a846d2195712ULL, 0x8974836059cca109ULL},
+    {0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL}, {0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL},
+    {0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL}, {0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL},
+    {0x8e938662882af53eULL, 0x547eb47b7282ee9cULL}, {0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL},
+    {0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL}, {0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL},
+    {0xae0b158b4738705eULL, 0x9624ab50b148d445ULL}, {0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL},
+    {0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL}, {0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL},
+    {0xd47487cc8470652bULL, 0x7647c3200069671fULL}, {0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL},
+    {0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL}, {0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL},
+    {0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL}, {0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL},
+    {0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL}, {0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL},
+    {0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL}, {0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL},
+    {0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL}, {0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL},
+    {0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL}, {0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL},
+    {0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL}, {0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL},
+    {0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL}, {0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL},
+    {0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL}, {0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL},
+    {0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL}, {0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL},
+    {0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL}, {0x8c974f7383725573ULL, 0x1e414218c73a13fbULL},
+    {0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL}, {0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL},
+    {0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL}, {0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL},
+    {0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL}, {0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL},
+    {0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL}, {0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL},
+    {0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL}, {0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL},
+    {0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL}, {0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL},
+    {0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL}, {0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL},
+    {0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL}, {0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL},
+    {0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL}, {0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL},
+    {0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL}, {0xbe89523386091465ULL, 0xf6bbb397f1135823ULL},
+    {0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL}, {0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL},
+    {0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL}, {0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL},
+    {0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL}, {0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL},
+    {0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL}, {0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL},
+    {0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL}, {0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL},
+    {0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL}, {0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL},
+    {0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL}, {0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL},
+    {0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL}, {0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL},
+    {0x843610cb4bf160cbULL, 0xcedf722a585139baULL}, {0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL},
+    {0xce947a3da6a9273eULL, 0x733d226229feea32ULL}, {0x811ccc668829b887ULL, 0x0806357d5a3f525fULL},
+    {0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL}, {0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL},
+    {0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL}, {0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL},
+    {0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL}, {0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL},
+    {0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL}, {0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL},
+    {0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL}, {0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL},
+    {0xbbe226efb628afeaULL, 0x890489f70a55368bULL}, {0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL},
+    {0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL}, {0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL},
+    {0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL}, {0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL},
+    {0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL}, {0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL},
+    {0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL}, {0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL},
+    {0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL}, {0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL},
+    {0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL}, {0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL},
+    {0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL}, {0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL},
+    {0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL}, {0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL},
+    {0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL}, {0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL},
+    {0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL}, {0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL},
+    {0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL}, {0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL},
+    {0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL}, {0xc24452da229b021bULL, 0xfbe85badce996168ULL},
+    {0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL}, {0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL},
+    {0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL}, {0xed246723473e3813ULL, 0x290123e9aab23b68ULL},
+    {0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL}, {0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL},
+    {0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL}, {0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL},
+    {0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL}, {0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL},
+    {0x8d590723948a535fULL, 0x579c487e5a38ad0eULL}, {0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL},
+    {0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL}, {0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL},
+    {0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL}, {0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL},
+    {0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL}, {0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL},
+    {0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL}, {0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL},
+    {0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL}, {0xcdb02555653131b6ULL, 0x3792f412cb06794dULL},
+    {0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL}, {0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL},
+    {0xc8de047564d20a8bULL, 0xf245825a5a445275ULL}, {0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL},
+    {0x9ced737bb6c4183dULL, 0x55464dd69685606bULL}, {0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL},
+    {0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL}, {0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL},
+    {0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL}, {0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL},
+    {0x95a8637627989aadULL, 0xdde7001379a44aa8ULL}, {0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL},
+    {0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL}, {0x9226712162ab070dULL, 0xcab3961304ca70e8ULL},
+    {0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL}, {0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL},
+    {0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL}, {0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL},
+    {0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL}, {0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL},
+    {0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL}, {0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL},
+    {0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL}, {0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL},
+    {0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL}, {0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL},
+    {0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL}, {0xcfb11ead453994baULL, 0x67de18eda5814af2ULL},
+    {0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL}, {0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL},
+    {0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL}, {0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL},
+    {0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL}, {0xc612062576589ddaULL, 0x95364afe032a819eULL},
+    {0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL}, {0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL},
+    {0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL}, {0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL},
+    {0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL}, {0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL},
+    {0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL}, {0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL},
+    {0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL}, {0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL},
+    {0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL}, {0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL},
+    {0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL}, {0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL},
+    {0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL}, {0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL},
+    {0x89705f4136b4a597ULL, 0x31680a88f8953031ULL}, {0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL},
+    {0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL}, {0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL},
+    {0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL}, {0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL},
+    {0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL}, {0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL},
+    {0xccccccccccccccccULL, 0xcccccccccccccccdULL}, {0x8000000000000000ULL, 0x0000000000000000ULL},
+    {0xa000000000000000ULL, 0x0000000000000000ULL}, {0xc800000000000000ULL, 0x0000000000000000ULL},
+    {0xfa00000000000000ULL, 0x0000000000000000ULL}, {0x9c40000000000000ULL, 0x0000000000000000ULL},
+    {0xc350000000000000ULL, 0x0000000000000000ULL}, {0xf424000000000000ULL, 0x0000000000000000ULL},
+    {0x9896800000000000ULL, 0x0000000000000000ULL}, {0xbebc200000000000ULL, 0x0000000000000000ULL},
+    {0xee6b280000000000ULL, 0x0000000000000000ULL}, {0x9502f90000000000ULL, 0x0000000000000000ULL},
+    {0xba43b74000000000ULL, 0x0000000000000000ULL}, {0xe8d4a51000000000ULL, 0x0000000000000000ULL},
+    {0x9184e72a00000000ULL, 0x0000000000000000ULL}, {0xb5e620f480000000ULL, 0x0000000000000000ULL},
+    {0xe35fa931a0000000ULL, 0x0000000000000000ULL}, {0x8e1bc9bf04000000ULL, 0x0000000000000000ULL},
+    {0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL}, {0xde0b6b3a76400000ULL, 0x0000000000000000ULL},
+    {0x8ac7230489e80000ULL, 0x0000000000000000ULL}, {0xad78ebc5ac620000ULL, 0x0000000000000000ULL},
+    {0xd8d726b7177a8000ULL, 0x0000000000000000ULL}, {0x878678326eac9000ULL, 0x0000000000000000ULL},
+    {0xa968163f0a57b400ULL, 0x0000000000000000ULL}, {0xd3c21bcecceda100ULL, 0x0000000000000000ULL},
+    {0x84595161401484a0ULL, 0x0000000000000000ULL}, {0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL},
+    {0xcecb8f27f4200f3aULL, 0x0000000000000000ULL}, {0x813f3978f8940984ULL, 0x4000000000000000ULL},
+    {0xa18f07d736b90be5ULL, 0x5000000000000000ULL}, {0xc9f2c9cd04674edeULL, 0xa400000000000000ULL},
+    {0xfc6f7c4045812296ULL, 0x4d00000000000000ULL}, {0x9dc5ada82b70b59dULL, 0xf020000000000000ULL},
+    {0xc5371912364ce305ULL, 0x6c28000000000000ULL}, {0xf684df56c3e01bc6ULL, 0xc732000000000000ULL},
+    {0x9a130b963a6c115cULL, 0x3c7f400000000000ULL}, {0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL},
+    {0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL}, {0x96769950b50d88f4ULL, 0x1314448000000000ULL},
+    {0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL}, {0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL},
+    {0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL}, {0xb7abc627050305adULL, 0xf14a3d9e40000000ULL},
+    {0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL}, {0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL},
+    {0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL}, {0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL},
+    {0x8c213d9da502de45ULL, 0x4526f422cc340000ULL}, {0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL},
+    {0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL}, {0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL},
+    {0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL}, {0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL},
+    {0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL}, {0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL},
+    {0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL}, {0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL},
+    {0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL}, {0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL},
+    {0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL}, {0x9f4f2726179a2245ULL, 0x01d762422c946590ULL},
+    {0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL}, {0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL},
+    {0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL}, {0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL},
+    {0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL}, {0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL},
+    {0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL}, {0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL},
+    {0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL}, {0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL},
+    {0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL}, {0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL},
+    {0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL}, {0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL},
+    {0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL}, {0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL},
+    {0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL}, {0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL},
+    {0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL}, {0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL},
+    {0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL}, {0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL},
+    {0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL}, {0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL},
+    {0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL}, {0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL},
+    {0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL}, {0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL},
+    {0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL}, {0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL},
+    {0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL}, {0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL},
+    {0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL}, {0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL},
+    {0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL}, {0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL},
+    {0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL}, {0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL},
+    {0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL}, {0x924d692ca61be758ULL, 0x593c2626705f9c56ULL},
+    {0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL}, {0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL},
+    {0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL}, {0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL},
+    {0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL}, {0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL},
+    {0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL}, {0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL},
+    {0x884134fe908658b2ULL, 0x3109058d147fdcddULL}, {0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL},
+    {0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL}, {0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL},
+    {0xa6539930bf6bff45ULL, 0x84db8346b786151cULL}, {0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL},
+    {0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL}, {0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL},
+    {0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL}, {0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL},
+    {0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL}, {0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL},
+    {0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL}, {0x9ae757596946075fULL, 0x3375788de9b06958ULL},
+    {0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL}, {0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL},
+    {0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL}, {0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL},
+    {0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL}, {0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL},
+    {0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL}, {0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL},
+    {0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL}, {0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL},
+    {0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL}, {0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL},
+    {0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL}, {0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL},
+    {0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL}, {0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL},
+    {0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL}, {0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL},
+    {0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL}, {0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL},
+    {0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL}, {0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL},
+    {0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL}, {0x802221226be55a64ULL, 0xc2494954da2c9789ULL},
+    {0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL}, {0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL},
+    {0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL}, {0x9c69a97284b578d7ULL, 0xff2a760414536efbULL},
+    {0xc38413cf25e2d70dULL, 0xfef5138519684abaULL}, {0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL},
+    {0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL}, {0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL},
+    {0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL}, {0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL},
+    {0xba756174393d88dfULL, 0x94f971119aeef9e4ULL}, {0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL},
+    {0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL}, {0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL},
+    {0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL}, {0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL},
+    {0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL}, {0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL},
+    {0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL}, {0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL},
+    {0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL}, {0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL},
+    {0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL}, {0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL},
+    {0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL}, {0xa59bc234db398c25ULL, 0x43fab9837e699095ULL},
+    {0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL}, {0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL},
+    {0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL}, {0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL},
+    {0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL}, {0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL},
+    {0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL}, {0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL},
+    {0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL}, {0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL},
+    {0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL}, {0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL},
+    {0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL}, {0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL},
+    {0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL}, {0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL},
+    {0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL}, {0x8fa475791a569d10ULL, 0xf96e017d694487bcULL},
+    {0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL}, {0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL},
+    {0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL}, {0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL},
+    {0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL}, {0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL},
+    {0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL}, {0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL},
+    {0x85c7056562757456ULL, 0xf6872d5667844e49ULL}, {0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL},
+    {0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL}, {0x82a45b450226b39cULL, 0xecc0024661173473ULL},
+    {0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL}, {0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL},
+    {0xff290242c83396ceULL, 0x7e67047175a15271ULL}, {0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL},
+    {0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL}, {0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL},
+    {0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL}, {0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL},
+    {0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL}, {0x98165af37b2153deULL, 0xc3727a337a8b704aULL},
+    {0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL}, {0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL},
+    {0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL}, {0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL},
+    {0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL}, {0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL},
+    {0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL}, {0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL},
+    {0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL}, {0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL},
+    {0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL}, {0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL},
+    {0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL}, {0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL},
+    {0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL}, {0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL},
+    {0xd31045a8341ca07cULL, 0x1ede48111209a050ULL}, {0x83ea2b892091e44dULL, 0x934aed0aab460432ULL},
+    {0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL}, {0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL},
+    {0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL}, {0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL},
+    {0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL}, {0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL},
+    {0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL}, {0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL},
+    {0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL}, {0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL},
+    {0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL}, {0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL},
+    {0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL}, {0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL},
+    {0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL}, {0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL},
+    {0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL}, {0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL},
+    {0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL}, {0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL},
+    {0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL}, {0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL},
+    {0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL}, {0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL},
+    {0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL}, {0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL},
+    {0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL}, {0x8533285c936b35deULL, 0xd53a88958f87275fULL},
+    {0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL}, {0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL},
+    {0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL}, {0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL},
+    {0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL}, {0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL},
+    {0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL}, {0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL},
+    {0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL}, {0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL},
+    {0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL}, {0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL},
+    {0x976e41088617ca01ULL, 0xd5be0503e085d813ULL}, {0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL},
+    {0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL}, {0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL},
+    {0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL}, {0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL},
+    {0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL}, {0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL},
+    {0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL}, {0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL},
+    {0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL}, {0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL},
+    {0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL}, {0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL},
+    {0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL}, {0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL},
+    {0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL}, {0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL},
+    {0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL}, {0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL},
+    {0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL}, {0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL},
+    {0xa0555e361951c366ULL, 0xd7e105bcc332621fULL}, {0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL},
+    {0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL}, {0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL},
+    {0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL}, {0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL},
+    {0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL}, {0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL},
+    {0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL}, {0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL},
+    {0xbaa718e68396cffdULL, 0xd30560258f54e6baULL}, {0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL},
+    {0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL}, {0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL},
+    {0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL}, {0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL},
+};
 
-void advance(Parser* parser) {
-    if (parser->tokens[parser->index].type != TOKEN_EOF) {
-        parser->index++;
-    }
+static inline uint64_t cjson_mul_64x64(uint64_t a, uint64_t b, uint64_t* high) {
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 cjson_uint128;
+    cjson_uint128 product = (cjson_uint128)a * b;
+    *high = (uint64_t)(product >> 64);
+    return (uint64_t)product;
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    *high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return (cross << 32) | (uint32_t)lo_lo;
+#endif
 }
 
-void parse_object(Parser* parser, JsonValue* json_object);
-void parse_array(Parser* parser, JsonValue* json_object);
-
+static inline int cjson_clz64(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & ((uint64_t)1 << 63))) { x <<= 1; n++; }
+    return n;
+#endif
+}
 
-JsonValue parse_value(Parser* parser){
-    CjsonToken token = parser->tokens[parser->index];
+// Eisel-Lemire: mantissa * 10^power rounded to nearest even. False when the
+// product lands too close to a halfway point or outside the normal range.
+static bool cjson_eisel_lemire(uint64_t mantissa, int64_t power, bool negative, double* out) {
+    if (power < CJSON_SMALLEST_POWER_OF_TEN || power > CJSON_LARGEST_POWER_OF_TEN) return false;
+
+    const uint64_t* factor = cjson_power_of_five_128[power - CJSON_SMALLEST_POWER_OF_TEN];
+    int64_t exponent = (((152170 + 65536) * power) >> 16) + 1024 + 63;
+    int lz = cjson_clz64(mantissa);
+    mantissa <<= lz;
+
+    uint64_t upper;
+    uint64_t lower = cjson_mul_64x64(mantissa, factor[0], &upper);
+    if ((upper & 0x1FF) == 0x1FF && lower + mantissa < lower) {
+        uint64_t middle2;
+        uint64_t product_low = cjson_mul_64x64(mantissa, factor[1], &middle2);
+        uint64_t middle = lower + middle2;
+        if (middle < lower) upper++;
+        if (middle + 1 == 0 && (upper & 0x1FF) == 0x1FF && product_low + mantissa < product_low) {
+            return false;
+        }
+        lower = middle;
+    }
 
-    JsonValue value;
+    uint64_t upper_bit = upper >> 63;
+    uint64_t bits = upper >> (upper_bit + 9);
+    lz += (int)(1 ^ upper_bit);
+    if (lower == 0 && (upper & 0x1FF) == 0 && (bits & 3) == 1) return false;
 
-    switch(token.type){
-        case TOKEN_CJSON_STRING:
-            value.type = JSON_STRING;
-            value.string = malloc((token.length+1)*sizeof(char));
-            memcpy(value.string, token.start, token.length);
-            value.string[token.length] = '\0';
-            advance(parser);
-            break;
-        case TOKEN_NUMBER:
-            value.type = JSON_NUMBER;
-            char* number_string = malloc((token.length+1)*sizeof(char));
-            memcpy(number_string, token.start, token.length);
-            number_string[token.length] = '\0';
-            value.number = atof(number_string);
-            free(number_string);
-            advance(parser);
-            break;
-        case TOKEN_TRUE:
-            value.type = JSON_BOOL;
-            value.boolean = 1;
-            advance(parser);
-            break;
-        case TOKEN_FALSE:
-            value.type = JSON_BOOL;
-            value.boolean = 0;
-            advance(parser);
-            break;
-        case TOKEN_NULL:
-            value.type = JSON_NULL;
-            advance(parser);
-            break;
-        case TOKEN_LEFT_BRACE:
-            parse_object(parser, &value);
-            break;
-        case TOKEN_LEFT_BRACKET:
-            parse_array(parser, &value);
-            break;
-        default:
-            printf("Unexpected token: %.*s type=%u\n", (int)token.length, token.start, token.type);
-            exit(1);
+    bits += bits & 1;
+    bits >>= 1;
+    if (bits >= ((uint64_t)1 << 53)) {
+        bits = (uint64_t)1 << 52;
+        lz--;
     }
-    return value;
+    bits &= ~((uint64_t)1 << 52);
+    int64_t real_exponent = exponent - lz;
+    if (real_exponent < 1 || real_exponent > 2046) return false;
+
+    bits |= (uint64_t)real_exponent << 52;
+    bits |= (uint64_t)negative << 63;
+    memcpy(out, &bits, sizeof(*out));
+    return true;
 }
 
-CjsonToken get_current_token(Parser* parser) {
-    size_t len = arrlenu(parser->tokens);
-    if (parser->index >= len) {
-        printf("Parser index %lu out of bounds (len=%lu)\n", (long int)parser->index, (long int)len);
-        CjsonToken t = { .type = TOKEN_EOF, .start = NULL, .length = 0 };
-        return t;
+// strtod honours the locale's decimal point, JSON always uses '.'
+static double cjson_strtod_fallback(const char* start, size_t length) {
+    char stack_buffer[128];
+    char* copy = length < sizeof(stack_buffer) ? stack_buffer : malloc(length + 1);
+    memcpy(copy, start, length);
+    copy[length] = '\0';
+
+    char decimal_point = localeconv()->decimal_point[0];
+    if (decimal_point != '.') {
+        char* dot = memchr(copy, '.', length);
+        if (dot) *dot = decimal_point;
     }
-    return parser->tokens[parser->index];
+
+    double result = strtod(copy, NULL);
+    if (copy != stack_buffer) free(copy);
+    return result;
 }
 
-void parse_object(Parser* parser, JsonValue* json_object) {
-    json_object->type = JSON_OBJECT;
-    json_object->object = NULL;
+static const double cjson_exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-    advance(parser); // skip "{"
+#define CJSON_MAX_EXACT_DOUBLE_INT ((uint64_t)1 << 53)
+
+// Fills value from a lexed TOKEN_NUMBER. Integers with a magnitude above 2^53
+// that still fit 64 bits keep their exact value too (JSON_FLAG_INT64/UINT64).
+void cjson_number_from_token(const char* start, size_t length, JsonValue* value) {
+    const char* p = start;
+    const char* end = start + length;
+    bool negative = (*p == '-');
+    if (negative) p++;
+
+    uint64_t mantissa = 0;
+    int significant_digits = 0;
+    int64_t exponent = 0;
+    bool integral = true;
+
+    for (; p < end && isdigit((uint8_t)*p); p++) {
+        if (mantissa == 0 && *p == '0') continue;
+        if (significant_digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        } else {
+            exponent++;
+        }
+        significant_digits++;
+    }
+    size_t integer_digits = significant_digits;
+
+    if (p < end && *p == '.') {
+        integral = false;
+        for (p++; p < end && isdigit((uint8_t)*p); p++) {
+            if (mantissa == 0 && *p == '0') {
+                exponent--;
+                continue;
+            }
+            if (significant_digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                exponent--;
+            }
+            significant_digits++;
+        }
+    }
 
-    while (get_current_token(parser).type != TOKEN_RIGHT_BRACE) {
-        CjsonToken key_token = get_current_token(parser);
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        integral = false;
+        p++;
+        bool exponent_negative = (*p == '-');
+        if (*p == '-' || *p == '+') p++;
+        int64_t explicit_exponent = 0;
+        for (; p < end && isdigit((uint8_t)*p); p++) {
+            if (explicit_exponent < 100000) {
+                explicit_exponent = explicit_exponent * 10 + (*p - '0');
+            }
+        }
+        exponent += exponent_negative ? -explicit_exponent : explicit_exponent;
+    }
 
-        if (key_token.type != TOKEN_CJSON_STRING) {
-            printf("Expected string key but %s found. at %lu\n", token_type_to_string(key_token.type), (long int)parser->index);
-            exit(1);
+    value->type = JSON_NUMBER;
+    value->flags = 0;
+
+    if (integral && integer_digits <= 20) {
+        // up to 20 digits: finish the exact value, watching for uint64 overflow
+        uint64_t exact = mantissa;
+        bool overflow = false;
+        if (integer_digits == 20) {
+            uint64_t last_digit = (uint64_t)(end[-1] - '0');
+            overflow = exact > (UINT64_MAX - last_digit) / 10;
+            exact = exact * 10 + last_digit;
+        }
+        if (!overflow && exact > CJSON_MAX_EXACT_DOUBLE_INT) {
+            if (negative && exact <= (uint64_t)INT64_MAX + 1) {
+                value->flags = JSON_FLAG_INT64;
+                value->integer = (int64_t)(0 - exact);
+                value->number = -(double)exact;
+                return;
+            }
+            if (!negative) {
+                value->flags = exact <= (uint64_t)INT64_MAX ? JSON_FLAG_INT64 : JSON_FLAG_UINT64;
+                value->uinteger = exact;
+                value->number = (double)exact;
+                return;
+            }
+        }
+        if (!overflow && exact <= CJSON_MAX_EXACT_DOUBLE_INT) {
+            value->number = negative ? -(double)exact : (double)exact;
+            return;
         }
+    }
 
-        char* key = malloc((key_token.length+1)*sizeof(char));
-        memcpy(key, key_token.start, key_token.length);
-        key[key_token.length] = '\0';
-        advance(parser);
+    if (mantissa == 0) {
+        value->number = negative ? -0.0 : 0.0;
+        return;
+    }
 
-        if (get_current_token(parser).type != TOKEN_COLON) {
-            printf("Expected ':'\n");
-            exit(1);
+    if (significant_digits <= 19) {
+        if (mantissa <= CJSON_MAX_EXACT_DOUBLE_INT && exponent >= -22 && exponent <= 22) {
+            double d = (double)mantissa;
+            d = exponent < 0 ? d / cjson_exact_powers_of_ten[-exponent]
+                             : d * cjson_exact_powers_of_ten[exponent];
+            value->number = negative ? -d : d;
+            return;
         }
+        if (cjson_eisel_lemire(mantissa, exponent, negative, &value->number)) {
+            return;
+        }
+    }
 
-        advance(parser);
+    value->number = cjson_strtod_fallback(start, length);
+}
 
-        JsonValue value = parse_value(parser);
-        JsonValue* heap_value = malloc(sizeof(JsonValue));
-        *heap_value = value;
+// Shortest round-trip double formatting (Grisu2, Loitsch 2010). The output
+// always parses back to the same double and is the shortest such string in
+// nearly every case. Integral values below 1e21 are written out in full.
+#define CJSON_NUMBER_BUFFER_SIZE 32
 
-        shput(json_object->object, key, heap_value);
+typedef struct {
+    uint64_t f;
+    int e;
+} CjsonDiyFp;
 
-        if (get_current_token(parser).type == TOKEN_COMMA) {
-            advance(parser);
-        } else if (get_current_token(parser).type != TOKEN_RIGHT_BRACE) {
-            printf("Expected ',' or '}'\n");
-            exit(1);
-        }
-    }
+typedef struct {
+    uint64_t f;
+    int e;
+    int k;
+} CjsonCachedPower;
+
+// normalized 10^k for k = -300, -292, ..., 324
+static const CjsonCachedPower cjson_cached_powers[] = {
+    {0xAB70FE17C79AC6CAULL, -1060, -300}, {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+    {0xBE5691EF416BD60CULL, -1007, -284}, {0x8DD01FAD907FFC3CULL, -980, -276},
+    {0xD3515C2831559A83ULL, -954, -268}, {0x9D71AC8FADA6C9B5ULL, -927, -260},
+    {0xEA9C227723EE8BCBULL, -901, -252}, {0xAECC49914078536DULL, -874, -244},
+    {0x823C12795DB6CE57ULL, -847, -236}, {0xC21094364DFB5637ULL, -821, -228},
+    {0x9096EA6F3848984FULL, -794, -220}, {0xD77485CB25823AC7ULL, -768, -212},
+    {0xA086CFCD97BF97F4ULL, -741, -204}, {0xEF340A98172AACE5ULL, -715, -196},
+    {0xB23867FB2A35B28EULL, -688, -188}, {0x84C8D4DFD2C63F3BULL, -661, -180},
+    {0xC5DD44271AD3CDBAULL, -635, -172}, {0x936B9FCEBB25C996ULL, -608, -164},
+    {0xDBAC6C247D62A584ULL, -582, -156}, {0xA3AB66580D5FDAF6ULL, -555, -148},
+    {0xF3E2F893DEC3F126ULL, -529, -140}, {0xB5B5ADA8AAFF80B8ULL, -502, -132},
+    {0x87625F056C7C4A8BULL, -475, -124}, {0xC9BCFF6034C13053ULL, -449, -116},
+    {0x964E858C91BA2655ULL, -422, -108}, {0xDFF9772470297EBDULL, -396, -100},
+    {0xA6DFBD9FB8E5B88FULL, -369, -92}, {0xF8A95FCF88747D94ULL, -343, -84},
+    {0xB94470938FA89BCFULL, -316, -76}, {0x8A08F0F8BF0F156BULL, -289, -68},
+    {0xCDB02555653131B6ULL, -263, -60}, {0x993FE2C6D07B7FACULL, -236, -52},
+    {0xE45C10C42A2B3B06ULL, -210, -44}, {0xAA242499697392D3ULL, -183, -36},
+    {0xFD87B5F28300CA0EULL, -157, -28}, {0xBCE5086492111AEBULL, -130, -20},
+    {0x8CBCCC096F5088CCULL, -103, -12}, {0xD1B71758E219652CULL, -77, -4},
+    {0x9C40000000000000ULL, -50, 4}, {0xE8D4A51000000000ULL, -24, 12},
+    {0xAD78EBC5AC620000ULL, 3, 20}, {0x813F3978F8940984ULL, 30, 28},
+    {0xC097CE7BC90715B3ULL, 56, 36}, {0x8F7E32CE7BEA5C70ULL, 83, 44},
+    {0xD5D238A4ABE98068ULL, 109, 52}, {0x9F4F2726179A2245ULL, 136, 60},
+    {0xED63A231D4C4FB27ULL, 162, 68}, {0xB0DE65388CC8ADA8ULL, 189, 76},
+    {0x83C7088E1AAB65DBULL, 216, 84}, {0xC45D1DF942711D9AULL, 242, 92},
+    {0x924D692CA61BE758ULL, 269, 100}, {0xDA01EE641A708DEAULL, 295, 108},
+    {0xA26DA3999AEF774AULL, 322, 116}, {0xF209787BB47D6B85ULL, 348, 124},
+    {0xB454E4A179DD1877ULL, 375, 132}, {0x865B86925B9BC5C2ULL, 402, 140},
+    {0xC83553C5C8965D3DULL, 428, 148}, {0x952AB45CFA97A0B3ULL, 455, 156},
+    {0xDE469FBD99A05FE3ULL, 481, 164}, {0xA59BC234DB398C25ULL, 508, 172},
+    {0xF6C69A72A3989F5CULL, 534, 180}, {0xB7DCBF5354E9BECEULL, 561, 188},
+    {0x88FCF317F22241E2ULL, 588, 196}, {0xCC20CE9BD35C78A5ULL, 614, 204},
+    {0x98165AF37B2153DFULL, 641, 212}, {0xE2A0B5DC971F303AULL, 667, 220},
+    {0xA8D9D1535CE3B396ULL, 694, 228}, {0xFB9B7CD9A4A7443CULL, 720, 236},
+    {0xBB764C4CA7A44410ULL, 747, 244}, {0x8BAB8EEFB6409C1AULL, 774, 252},
+    {0xD01FEF10A657842CULL, 800, 260}, {0x9B10A4E5E9913129ULL, 827, 268},
+    {0xE7109BFBA19C0C9DULL, 853, 276}, {0xAC2820D9623BF429ULL, 880, 284},
+    {0x80444B5E7AA7CF85ULL, 907, 292}, {0xBF21E44003ACDD2DULL, 933, 300},
+    {0x8E679C2F5E44FF8FULL, 960, 308}, {0xD433179D9C8CB841ULL, 986, 316},
+    {0x9E19DB92B4E31BA9ULL, 1013, 324},
+};
 
-    advance(parser); // Skip '}'
+static CjsonDiyFp cjson_diyfp_mul(CjsonDiyFp x, CjsonDiyFp y) {
+    uint64_t high;
+    uint64_t low = cjson_mul_64x64(x.f, y.f, &high);
+    CjsonDiyFp result = { high + (low >> 63), x.e + y.e + 64 }; // round to nearest
+    return result;
 }
 
-void parse_array(Parser* parser, JsonValue* json_object) {
-    json_object->type = JSON_ARRAY;
-    json_object->array = NULL;
-
-    advance(parser); // Skip '['
+static CjsonDiyFp cjson_diyfp_normalize(CjsonDiyFp x) {
+    int shift = cjson_clz64(x.f);
+    x.f <<= shift;
+    x.e -= shift;
+    return x;
+}
 
-    while (get_current_token(parser).type != TOKEN_RIGHT_BRACKET) {
-        JsonValue value = parse_value(parser);
-        JsonValue* heap_value = malloc(sizeof(JsonValue));
-        *heap_value = value;
+static void cjson_grisu2_round(char* buffer, int length, uint64_t dist, uint64_t delta,
+                               uint64_t rest, uint64_t ten_k) {
+    while (rest < dist && delta - rest >= ten_k &&
+           (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+        buffer[length - 1]--;
+        rest += ten_k;
+    }
+}
 
-        arrput(json_object->array, heap_value);
+static void cjson_grisu2_digit_gen(char* buffer, int* length, int* decimal_exponent,
+                                   CjsonDiyFp m_minus, CjsonDiyFp w, CjsonDiyFp m_plus) {
+    uint64_t delta = m_plus.f - m_minus.f;
+    uint64_t dist = m_plus.f - w.f;
+    int shift = -m_plus.e;
+    uint64_t one = (uint64_t)1 << shift;
+
+    uint32_t p1 = (uint32_t)(m_plus.f >> shift);
+    uint64_t p2 = m_plus.f & (one - 1);
+
+    uint32_t pow10 = 1000000000;
+    int n = 10;
+    while (n > 1 && p1 < pow10) {
+        pow10 /= 10;
+        n--;
+    }
 
-        if (get_current_token(parser).type == TOKEN_COMMA) {
-            advance(parser);
-        } else if (get_current_token(parser).type != TOKEN_RIGHT_BRACKET) {
-            printf("Expected ',' or ']'\n");
-            exit(1);
+    while (n > 0) {
+        buffer[(*length)++] = (char)('0' + p1 / pow10);
+        p1 %= pow10;
+        n--;
+        uint64_t rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta) {
+            *decimal_exponent += n;
+            cjson_grisu2_round(buffer, *length, dist, delta, rest, (uint64_t)pow10 << shift);
+            return;
         }
+        pow10 /= 10;
     }
 
-    advance(parser); // Skip ']'
+    int m = 0;
+    while (true) {
+        p2 *= 10;
+        buffer[(*length)++] = (char)('0' + (p2 >> shift));
+        p2 &= one - 1;
+        m++;
+        delta *= 10;
+        dist *= 10;
+        if (p2 <= delta) break;
+    }
+    *decimal_exponent -= m;
+    cjson_grisu2_round(buffer, *length, dist, delta, p2, one);
 }
 
-void parse_json(CjsonToken* tokens, JsonValue* output) {
-    Parser parser = { tokens, 0 };
-
-    if (tokens[0].type == TOKEN_LEFT_BRACE) {
-        parse_object(&parser, output);
-    } else if (tokens[0].type == TOKEN_LEFT_BRACKET) {
-        parse_array(&parser, output);
+// Digits of a positive finite value; value = digits * 10^decimal_exponent
+static int cjson_grisu2(double value, char* buffer, int* decimal_exponent) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint64_t fraction = bits & (((uint64_t)1 << 52) - 1);
+    int biased_exponent = (int)(bits >> 52);
+
+    CjsonDiyFp v;
+    if (biased_exponent == 0) {
+        v.f = fraction;
+        v.e = 1 - 1075;
     } else {
-        printf("error: root must be object or array\n");
-        exit(1);
+        v.f = fraction | ((uint64_t)1 << 52);
+        v.e = biased_exponent - 1075;
     }
 
-    // After parsing, we should be at EOF
-    if (get_current_token(&parser).type != TOKEN_EOF) {
-        printf("warning: extra tokens after root JSON value at index %lu\n", (long int)parser.index);
-    }
+    // boundaries halfway to the neighbouring doubles
+    bool lower_is_closer = fraction == 0 && biased_exponent > 1;
+    CjsonDiyFp plus = { 2 * v.f + 1, v.e - 1 };
+    CjsonDiyFp minus = lower_is_closer ? (CjsonDiyFp){ 4 * v.f - 1, v.e - 2 }
+                                       : (CjsonDiyFp){ 2 * v.f - 1, v.e - 1 };
+    plus = cjson_diyfp_normalize(plus);
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    v = cjson_diyfp_normalize(v);
+
+    // pick 10^-k so the scaled exponent lands in [-60, -32]
+    int f = -60 - plus.e - 1;
+    int k = (f * 78913) / (1 << 18) + (f > 0);
+    int index = (300 + k + 7) / 8;
+    CjsonCachedPower cached = cjson_cached_powers[index];
+    CjsonDiyFp c = { cached.f, cached.e };
+
+    CjsonDiyFp w = cjson_diyfp_mul(v, c);
+    CjsonDiyFp w_minus = cjson_diyfp_mul(minus, c);
+    CjsonDiyFp w_plus = cjson_diyfp_mul(plus, c);
+    w_minus.f += 1;
+    w_plus.f -= 1;
+
+    int length = 0;
+    *decimal_exponent = -cached.k;
+    cjson_grisu2_digit_gen(buffer, &length, decimal_exponent, w_minus, w, w_plus);
+    return length;
 }
 
+static size_t cjson_format_exponent(char* buffer, int exponent) {
+    char* p = buffer;
+    *p++ = 'e';
+    if (exponent < 0) {
+        *p++ = '-';
+        exponent = -exponent;
+    } else {
+        *p++ = '+';
+    }
+    if (exponent >= 100) *p++ = (char)('0' + exponent / 100);
+    if (exponent >= 10) *p++ = (char)('0' + exponent / 10 % 10);
+    *p++ = (char)('0' + exponent % 10);
+    return (size_t)(p - buffer);
+}
 
+// Lays out digits * 10^exponent the way JavaScript does: plain notation for
+// decimal points within 21 digits, exponent notation beyond that
+static size_t cjson_format_decimal(char* buffer, int length, int exponent) {
+    int point = length + exponent;
 
-static void get_indentation(int depth, int spaces, char *buffer, size_t bufsize) {
-    if (depth < 0) depth = 0;
-
-    int totalSpaces = depth * spaces;
-    if ((size_t)totalSpaces >= bufsize) {
-        totalSpaces = (int)bufsize - 1; // prevent overflow
+    if (exponent >= 0 && point <= 21) {
+        memset(buffer + length, '0', (size_t)exponent);
+        return (size_t)point;
+    }
+    if (point > 0 && point <= 21) {
+        memmove(buffer + point + 1, buffer + point, (size_t)(length - point));
+        buffer[point] = '.';
+        return (size_t)length + 1;
+    }
+    if (point > -6 && point <= 0) {
+        memmove(buffer + 2 - point, buffer, (size_t)length);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        memset(buffer + 2, '0', (size_t)-point);
+        return (size_t)(2 - point + length);
     }
+    if (length == 1) {
+        return 1 + cjson_format_exponent(buffer + 1, point - 1);
+    }
+    memmove(buffer + 2, buffer + 1, (size_t)length - 1);
+    buffer[1] = '.';
+    return (size_t)length + 1 + cjson_format_exponent(buffer + length + 1, point - 1);
+}
 
-    memset(buffer, ' ', totalSpaces);
-    buffer[totalSpaces] = '\0';
+static size_t cjson_format_uint64(uint64_t value, char* buffer) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] = digits[count - 1 - i];
+    }
+    return count;
 }
 
+// Writes the shortest round-trip text of value into buffer (at least
+// CJSON_NUMBER_BUFFER_SIZE bytes, not NUL-terminated) and returns its length.
+// NaN and infinities have no JSON spelling and come out as null.
+size_t cjson_format_double(double value, char* buffer) {
+    if (value != value || value - value != 0) {
+        memcpy(buffer, "null", 4);
+        return 4;
+    }
 
-static void sb_append(char **buf, const char *fmt, ...) {
-    char temp[1024];
-    va_list args;
-    va_start(args, fmt);
-    int n = vsnprintf(temp, sizeof(temp), fmt, args);
-    va_end(args);
+    char* p = buffer;
+    if (signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        *p++ = '0';
+        return (size_t)(p - buffer);
+    }
 
-    if (n < 0) return;
+    int exponent;
+    int length = cjson_grisu2(value, p, &exponent);
+    return (size_t)(p - buffer) + cjson_format_decimal(p, length, exponent);
+}
 
-    if ((size_t)n >= sizeof(temp)) {
-        char *heapbuf = malloc(n + 1);
-        va_start(args, fmt);
-        vsnprintf(heapbuf, n + 1, fmt, args);
-        va_end(args);
-        for (int i = 0; i < n; i++)
-            arrpush(*buf, heapbuf[i]);
-        free(heapbuf);
-    } else {
-        for (int i = 0; i < n; i++)
-            arrpush(*buf, temp[i]);
+size_t json_format_number(const JsonValue* json, char* buffer) {
+    if (json->flags & JSON_FLAG_UINT64) {
+        return cjson_format_uint64(json->uinteger, buffer);
     }
+    if (json->flags & JSON_FLAG_INT64) {
+        if (json->integer < 0) {
+            buffer[0] = '-';
+            return 1 + cjson_format_uint64(0 - (uint64_t)json->integer, buffer + 1);
+        }
+        return cjson_format_uint64((uint64_t)json->integer, buffer);
+    }
+    return cjson_format_double(json->number, buffer);
 }
 
+#ifndef CJSON_ARENA_BLOCK_SIZE
+    #define CJSON_ARENA_BLOCK_SIZE (1024 * 1024)
+#endif
 
-void json_dump(JsonValue *json, char **out) {
-    switch (json->type) {
-        case JSON_OBJECT: {
-            sb_append(out, "{");
-            JsonPair *pairs = json->object;
-            size_t first = 1;
-            for (size_t slot = 0; slot < hmlenu(pairs); slot++) {
-                if (pairs[slot].key == NULL) continue;
-                if (!first) sb_append(out, ",");
-                first = 0;
-                sb_append(out, "\"%s\":", pairs[slot].key);
-                json_dump(pairs[slot].value, out);
-            }
-            sb_append(out, "}");
-            break;
-        }
+typedef struct JsonArenaBlock {
+    struct JsonArenaBlock* next;
+    size_t used;
+    size_t capacity;
+} JsonArenaBlock;
 
-        case JSON_ARRAY: {
-            sb_append(out, "[");
-            JsonValue **values = json->array;
-            size_t count = arrlen(values);
-            for (size_t i = 0; i < count; i++) {
-                if (i > 0) sb_append(out, ",");
-                json_dump(values[i], out);
-            }
-            sb_append(out, "]");
-            break;
-        }
+// Bump allocator that owns every node, string and key of a document.
+// Arrays and objects still keep their stb_ds storage on the heap; the arena
+// remembers those containers and releases them in one flat pass.
+typedef struct {
+    JsonArenaBlock* blocks; // current block first
+    size_t block_size;
+    JsonValue** containers;
+} JsonArena;
+
+void json_arena_init(JsonArena* arena, size_t block_size){
+    arena->blocks = NULL;
+    arena->block_size = block_size ? block_size : CJSON_ARENA_BLOCK_SIZE;
+    arena->containers = NULL;
+}
 
-        case JSON_STRING:
-            sb_append(out, "\"%s\"", json->string);
-            break;
-        case JSON_NUMBER:
-            sb_append(out, "%g", json->number);
-            break;
-        case JSON_BOOL:
-            sb_append(out, "%s", json->boolean ? "true" : "false");
-            break;
-        case JSON_NULL:
-            sb_append(out, "null");
-            break;
+static void* cjson_block_bump(JsonArenaBlock* block, size_t size, size_t align){
+    uintptr_t base = (uintptr_t)(block + 1);
+    uintptr_t aligned = (base + block->used + (align - 1)) & ~(uintptr_t)(align - 1);
+    size_t offset = (size_t)(aligned - base);
+    if(offset > block->capacity || size > block->capacity - offset){
+        return NULL;
     }
+    block->used = offset + size;
+    return (void*)aligned;
 }
 
+void* json_arena_alloc_aligned(JsonArena* arena, size_t size, size_t align){
+    if(arena->blocks){
+        void* ptr = cjson_block_bump(arena->blocks, size, align);
+        if(ptr) return ptr;
+    }
 
-void json_print(JsonValue* json, size_t spaces, size_t depth) {
-    char indent[512]; // max indentation size — adjust as needed
-
-    switch (json->type) {
-        case JSON_OBJECT: {
-            printf("{\n");
-            depth++;
+    bool oversized = size + align > arena->block_size;
+    size_t capacity = oversized ? size + align : arena->block_size;
+    CJSON_STAT_ALLOC(sizeof(JsonArenaBlock) + capacity);
+    JsonArenaBlock* block = malloc(sizeof(JsonArenaBlock) + capacity);
+    if(!block){
+        fprintf(stderr, "Could not allocate arena block\n");
+        return NULL;
+    }
+    block->used = 0;
+    block->capacity = capacity;
+
+    if(oversized && arena->blocks){
+        // keep bumping from the partially used block
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+    }else{
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+    return cjson_block_bump(block, size, align);
+}
 
-            JsonPair *pairs = json->object; // hashmap of pairs
-            size_t count = hmlenu(pairs);
+void* json_arena_alloc(JsonArena* arena, size_t size){
+    return json_arena_alloc_aligned(arena, size, alignof(max_align_t));
+}
 
-            size_t i = 0;
-            for (size_t slot = 0; slot < hmlenu(pairs); slot++) {
-                if (pairs[slot].key == NULL) continue;
+char* json_arena_strndup(JsonArena* arena, const char* str, size_t n){
+    char* copy = json_arena_alloc_aligned(arena, n + 1, 1);
+    if(!copy) return NULL;
+    memcpy(copy, str, n);
+    copy[n] = '\0';
+    return copy;
+}
 
-                get_indentation(depth, spaces, indent, sizeof(indent));
-                printf("%s\"%s\": ", indent, pairs[slot].key);
-                json_print(pairs[slot].value, spaces, depth);
-                if (i < count - 1) printf(",");
-                printf("\n");
-                i++;
-            }
+static void cjson_object_release(JsonObject* object);
+void json_free(JsonValue *value);
 
-            depth--;
-            get_indentation(depth, spaces, indent, sizeof(indent));
-            printf("%s}", indent);
-            break;
+static void cjson_arena_release_containers(JsonArena* arena){
+    for(size_t i = 0; i < arrlenu(arena->containers); i++){
+        JsonValue* container = arena->containers[i];
+        if(container->type == JSON_ARRAY){
+            arrfree(container->array);
+        }else if(container->type == JSON_OBJECT){
+            cjson_object_release(container->object);
         }
-        case JSON_ARRAY: {
-            printf("[\n");
-            depth++;
+    }
+    arrfree(arena->containers);
+}
 
-            JsonValue** values = json->array; // dynamic array
-            size_t count = arrlen(values);
+// Drops everything allocated from the arena but keeps the newest block for reuse
+void json_arena_reset(JsonArena* arena){
+    cjson_arena_release_containers(arena);
+    if(!arena->blocks) return;
 
-            for (size_t i = 0; i < count; i++) {
-                get_indentation(depth, spaces, indent, sizeof(indent));
-                printf("%s", indent);
-                json_print(values[i], spaces, depth);
-                if (i < count - 1) {
-                    printf(",");
-                }
-                printf("\n");
-            }
+    JsonArenaBlock* block = arena->blocks->next;
+    while(block){
+        JsonArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks->next = NULL;
+    arena->blocks->used = 0;
+}
 
-            depth--;
-            get_indentation(depth, spaces, indent, sizeof(indent));
-            printf("%s]", indent);
-            break;
-        }
-        case JSON_STRING: {
-            printf("\"%s\"", json->string);
-            break;
-        }
-        case JSON_NUMBER: {
-            printf("%g", json->number);
-            break;
-        }
-        case JSON_BOOL: {
-            printf("%s", json->boolean ? "true" : "false");
-            break;
-        }
-        case JSON_NULL: {
-            printf("null");
-            break;
-        }
+void json_arena_free(JsonArena* arena){
+    cjson_arena_release_containers(arena);
+    JsonArenaBlock* block = arena->blocks;
+    while(block){
+        JsonArenaBlock* next = block->next;
+        free(block);
+        block = next;
     }
-    if(depth == 0){
-        printf("\n");
+    arena->blocks = NULL;
+}
+
+// FNV-1a, enough to spread short object keys
+static uint64_t cjson_hash_bytes(const char* data, size_t length){
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 0x100000001b3ULL;
     }
+    return hash;
 }
 
-void json_free(JsonValue *value) {
-    if (!value) return;
+// Key interning: every distinct object key is stored once and parsed
+// objects point at that copy, so equal keys are equal pointers. Share one
+// table across a document, an arena's lifetime or a whole batch; it must
+// outlive every document parsed with it.
+typedef struct {
+    const char* key;
+    uint32_t length;
+    uint32_t hash;
+} CjsonInternEntry;
 
-    switch (value->type) {
-        case JSON_ARRAY:
-            if (value->array) {
-                for (size_t i = 0; i < arrlenu(value->array); i++) {
-                    json_free(value->array[i]);
-                }
-                arrfree(value->array);
-            }
-            break;
+typedef struct {
+    CjsonInternEntry* entries;  // one per distinct key, stb_ds array
+    uint32_t* slots;            // open addressing: entry index + 1, 0 when empty
+    size_t capacity;            // slot count, a power of two
+    JsonArena* arena;           // where the key copies live; NULL means malloc
+} JsonKeyTable;
+
+void json_key_table_init(JsonKeyTable* table, JsonArena* arena){
+    table->entries = NULL;
+    table->slots = NULL;
+    table->capacity = 0;
+    table->arena = arena;
+}
 
-        case JSON_OBJECT:
-            if(value->object){
-                for (size_t i = 0; i < shlenu(value->object); i++) {
-                    free(value->object[i].key);
-                    json_free(value->object[i].value);
-                }
-                shfree(value->object);
-            }
-            break;
+static void cjson_key_table_grow(JsonKeyTable* table){
+    size_t capacity = table->capacity ? table->capacity * 2 : 64;
+    uint32_t* slots = calloc(capacity, sizeof(uint32_t));
+    for (size_t i = 0; i < arrlenu(table->entries); i++) {
+        size_t slot = table->entries[i].hash & (capacity - 1);
+        while (slots[slot]) slot = (slot + 1) & (capacity - 1);
+        slots[slot] = (uint32_t)(i + 1);
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+}
 
-        case JSON_STRING:
-            free(value->string);
-            break;
+// The table's copy of key (length bytes, need not be NUL-terminated)
+const char* json_key_intern(JsonKeyTable* table, const char* key, size_t length){
+    if ((arrlenu(table->entries) + 1) * 2 > table->capacity) {
+        cjson_key_table_grow(table);
+    }
 
-        case JSON_NUMBER:
-        case JSON_BOOL:
-        case JSON_NULL:
-            break;
+    uint32_t hash = (uint32_t)cjson_hash_bytes(key, length);
+    size_t mask = table->capacity - 1;
+    size_t slot = hash & mask;
+    while (table->slots[slot]) {
+        const CjsonInternEntry* entry = &table->entries[table->slots[slot] - 1];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0) {
+            return entry->key;
+        }
+        slot = (slot + 1) & mask;
     }
 
-    free(value);
+    char* copy;
+    if (table->arena) {
+        copy = json_arena_strndup(table->arena, key, length);
+    } else {
+        copy = malloc(length + 1);
+        memcpy(copy, key, length);
+        copy[length] = '\0';
+    }
+    CjsonInternEntry entry = { .key = copy, .length = (uint32_t)length, .hash = hash };
+    arrput(table->entries, entry);
+    table->slots[slot] = (uint32_t)arrlenu(table->entries);
+    return copy;
 }
 
-char *json_escape(const char *input) {
-    if (!input) return NULL;
+size_t json_key_table_count(const JsonKeyTable* table){
+    return arrlenu(table->entries);
+}
 
-    size_t len = strlen(input);
-    char *escaped = malloc(len * 6 + 1);
-    if (!escaped) return NULL;
-
-    char *p = escaped;
-    for (size_t i = 0; i < len; i++) {
-        unsigned char c = input[i];
-        switch (c) {
-            case '\"': *p++ = '\\'; *p++ = '\"'; break;
-            case '\\': *p++ = '\\'; *p++ = '\\'; break;
-            case '\b': *p++ = '\\'; *p++ = 'b';  break;
-            case '\f': *p++ = '\\'; *p++ = 'f';  break;
-            case '\n': *p++ = '\\'; *p++ = 'n';  break;
-            case '\r': *p++ = '\\'; *p++ = 'r';  break;
-            case '\t': *p++ = '\\'; *p++ = 't';  break;
-            default:
-                if (c < 0x20) {
-                    sprintf(p, "\\u%04x", c);
-                    p += 6;
-                } else {
-                    *p++ = c;
-                }
-                break;
+// Releases the table and its keys; documents parsed with it must be gone first
+void json_key_table_free(JsonKeyTable* table){
+    if (!table->arena) {
+        for (size_t i = 0; i < arrlenu(table->entries); i++) {
+            free((char*)table->entries[i].key);
         }
     }
-    *p = '\0';
-    return escaped;
+    arrfree(table->entries);
+    free(table->slots);
+    table->slots = NULL;
+    table->capacity = 0;
 }
 
-static char hex_to_char(const char *hex) {
-    int value = 0;
-    for (int i = 0; i < 4; i++) {
-        value <<= 4;
-        if (hex[i] >= '0' && hex[i] <= '9') value += hex[i] - '0';
-        else if (hex[i] >= 'a' && hex[i] <= 'f') value += hex[i] - 'a' + 10;
-        else if (hex[i] >= 'A' && hex[i] <= 'F') value += hex[i] - 'A' + 10;
-        else return '?'; // invalid hex
-    }
-    return (char)value;
+// Object members, see JsonObject
+static JsonObject* cjson_object_new(JsonArena* arena){
+    if(!arena) CJSON_STAT_ALLOC(sizeof(JsonObject));
+    JsonObject* object = arena ? json_arena_alloc_aligned(arena, sizeof(JsonObject), alignof(JsonObject))
+                               : malloc(sizeof(JsonObject));
+    object->pairs = NULL;
+    object->index = NULL;
+    object->capacity = 0;
+    return object;
 }
 
-char *json_unescape(const char *input) {
-    if (!input) return NULL;
+static inline size_t cjson_object_count(const JsonObject* object){
+    return object ? arrlenu(object->pairs) : 0;
+}
 
-    size_t len = strlen(input);
-    char *unescaped = malloc(len + 1);
-    if (!unescaped) return NULL;
+static void cjson_object_reindex(JsonObject* object, size_t capacity){
+    free(object->index);
+    object->index = calloc(capacity, sizeof(uint32_t));
+    object->capacity = capacity;
+    for (size_t i = 0; i < arrlenu(object->pairs); i++) {
+        const char* key = object->pairs[i].key;
+        size_t slot = cjson_hash_bytes(key, strlen(key)) & (capacity - 1);
+        while (object->index[slot]) slot = (slot + 1) & (capacity - 1);
+        object->index[slot] = (uint32_t)(i + 1);
+    }
+}
 
-    char *p = unescaped;
-    for (size_t i = 0; i < len; i++) {
-        if (input[i] == '\\') {
-            i++;
-            if (i >= len) break;
-            switch (input[i]) {
-                case '\"': *p++ = '\"'; break;
-                case '\\': *p++ = '\\'; break;
-                case '/':  *p++ = '/';  break;
-                case 'b':  *p++ = '\b'; break;
-                case 'f':  *p++ = '\f'; break;
-                case 'n':  *p++ = '\n'; break;
-                case 'r':  *p++ = '\r'; break;
-                case 't':  *p++ = '\t'; break;
-                case 'u':
-                    if (i + 4 < len) {
-                        *p++ = hex_to_char(&input[i + 1]);
-                        i += 4;
-                    }
-                    break;
-                default:
-                    *p++ = input[i];
-                    break;
+// Builds the index of a large object that has none yet; true when it has one
+static bool cjson_object_indexed(JsonObject* object){
+    size_t count = arrlenu(object->pairs);
+    if (!object->index && count > CJSON_SMALL_OBJECT_MAX) {
+        size_t capacity = 64;
+        while (capacity < count * 2) capacity *= 2;
+        cjson_object_reindex(object, capacity);
+    }
+    return object->index != NULL;
+}
+
+// Position of the length-byte key among the pairs, -1 when absent. hash is
+// cjson_hash_bytes(key, length) and only read when the object is indexed.
+static ptrdiff_t cjson_object_find_hashed(const JsonObject* object, const char* key, size_t length, uint64_t hash){
+    if (!object->index) {
+        // interned keys usually match by pointer before strcmp runs
+        for (size_t i = 0; i < arrlenu(object->pairs); i++) {
+            const char* candidate = object->pairs[i].key;
+            if (candidate == key || (candidate[0] == key[0] && strncmp(candidate, key, length) == 0 && candidate[length] == '\0')) {
+                return (ptrdiff_t)i;
             }
-        } else {
-            *p++ = input[i];
         }
+        return -1;
     }
-    *p = '\0';
-    return unescaped;
+    size_t mask = object->capacity - 1;
+    size_t slot = hash & mask;
+    while (object->index[slot]) {
+        const char* candidate = object->pairs[object->index[slot] - 1].key;
+        if (strncmp(candidate, key, length) == 0 && candidate[length] == '\0') return (ptrdiff_t)(object->index[slot] - 1);
+        slot = (slot + 1) & mask;
+    }
+    return -1;
 }
 
-void jsonFileLoad(const char* file_name, JsonValue* output){
-    char* file_content = file_read(file_name);
-    if(!file_content){
+// Position of key among the pairs, -1 when absent
+static ptrdiff_t cjson_object_find(JsonObject* object, const char* key){
+    if (!object) return -1;
+    size_t length = strlen(key);
+    uint64_t hash = cjson_object_indexed(object) ? cjson_hash_bytes(key, length) : 0;
+    return cjson_object_find_hashed(object, key, length, hash);
+}
+
+// Adds a member without checking for an existing key
+static void cjson_object_append(JsonObject* object, char* key, JsonValue* value){
+    JsonPair pair = { .key = key, .value = value };
+    arrput(object->pairs, pair);
+    if (!object->index) return;
+    size_t count = arrlenu(object->pairs);
+    if (count * 2 > object->capacity) {
+        cjson_object_reindex(object, object->capacity ? object->capacity * 2 : 64);
         return;
     }
-    CjsonToken* tokens = tokenize(file_content);
-    parse_json(tokens, output);
-    arrfree(file_content);
-    arrfree(tokens);
+    size_t mask = object->capacity - 1;
+    size_t slot = cjson_hash_bytes(key, strlen(key)) & mask;
+    while (object->index[slot]) slot = (slot + 1) & mask;
+    object->index[slot] = (uint32_t)count;
 }
 
-void jsonStringLoad(char* json_string, JsonValue* output){
-    CjsonToken* tokens = tokenize(json_string);
-    parse_json(tokens, output);
-    arrfree(tokens);
+// Repeated-key check for an object being built by a parser. Small objects
+// are scanned; past CJSON_SMALL_OBJECT_MAX members a scratch table owned by
+// the parser takes over and is freed when the object is done. It is never
+// attached, so a parsed object still gets its lookup index only on its
+// first keyed lookup and parse-then-dump never builds one.
+typedef struct {
+    uint32_t* slots; // open addressing: pair index + 1, 0 when empty
+    size_t capacity; // a power of two, 0 until the object outgrows the scan
+} CjsonKeyScratch;
+
+static void cjson_key_scratch_fill(CjsonKeyScratch* scratch, const JsonObject* object, size_t capacity){
+    free(scratch->slots);
+    scratch->slots = calloc(capacity, sizeof(uint32_t));
+    scratch->capacity = capacity;
+    for (size_t i = 0; i < arrlenu(object->pairs); i++) {
+        const char* key = object->pairs[i].key;
+        size_t slot = cjson_hash_bytes(key, strlen(key)) & (capacity - 1);
+        while (scratch->slots[slot]) slot = (slot + 1) & (capacity - 1);
+        scratch->slots[slot] = (uint32_t)(i + 1);
+    }
 }
 
-void json_init_object(JsonValue* json){
-    json->type = JSON_OBJECT;
-    json->object = NULL;
+// Position of key among the pairs, -1 when it is new. A new key is recorded
+// as the pair the caller appends next.
+static ptrdiff_t cjson_key_scratch_find(CjsonKeyScratch* scratch, const JsonObject* object, const char* key){
+    size_t count = arrlenu(object->pairs);
+    size_t length = strlen(key);
+    if (count < CJSON_SMALL_OBJECT_MAX) return cjson_object_find_hashed(object, key, length, 0);
+    if ((count + 1) * 2 > scratch->capacity) {
+        size_t capacity = scratch->capacity ? scratch->capacity * 2 : 64;
+        while (capacity < (count + 1) * 2) capacity *= 2;
+        cjson_key_scratch_fill(scratch, object, capacity);
+    }
+    size_t mask = scratch->capacity - 1;
+    size_t slot = cjson_hash_bytes(key, length) & mask;
+    while (scratch->slots[slot]) {
+        const char* candidate = object->pairs[scratch->slots[slot] - 1].key;
+        if (candidate == key || strcmp(candidate, key) == 0) return (ptrdiff_t)scratch->slots[slot] - 1;
+        slot = (slot + 1) & mask;
+    }
+    scratch->slots[slot] = (uint32_t)(count + 1);
+    return -1;
 }
 
-void json_init_array(JsonValue* json){
-    json->type = JSON_ARRAY;
-    json->array = NULL;
+// Drops the member at i; later members move down, so the index goes too
+static void cjson_object_remove_at(JsonObject* object, size_t i){
+    arrdel(object->pairs, i);
+    free(object->index);
+    object->index = NULL;
+    object->capacity = 0;
 }
 
-void json_add_child(JsonValue* json, const char* key, JsonValue* child) {
-    if (!child) {
-        fprintf(stderr, "Trying to add child that is NULL\n");
-        return;
-    }
-    if (json->type == JSON_OBJECT) {
-        if (key == NULL) {
-            fprintf(stderr, "Cannot put NULL key into object\n");
-            return;
-        }
-        char* key_copy = malloc((strlen(key) + 1) * sizeof(char));
-        memcpy(key_copy, key, strlen(key) + 1);
-        shput(json->object, key_copy, child);
-    } else if (json->type == JSON_ARRAY) {
-        if (key != NULL) {
-            fprintf(stderr, "Warn: Trying to add key to array\n");
+// Frees the pair array and index, not the keys, values or the JsonObject itself
+static void cjson_object_release(JsonObject* object){
+    if (!object) return;
+    arrfree(object->pairs);
+    free(object->index);
+    object->index = NULL;
+    object->capacity = 0;
+}
+
+// Tokens either come from a pre-built array (parse_json) or are pulled
+// from the input one at a time, so no token array is ever materialized.
+typedef struct {
+    CjsonToken* tokens; // NULL when streaming straight from json
+    size_t index;       // tokens consumed so far
+    JsonArena* arena;   // NULL when every node is malloc'd
+    bool insitu;        // decode strings in place inside json instead of copying
+    JsonKeyTable* keys; // intern object keys here instead of copying each one
+    char* json;
+    size_t position;
+    const uint32_t* structurals; // optional stage 1 index of token starts
+    size_t next_structural;
+    CjsonToken current;
+} Parser;
+
+static void cjson_parser_next_token(Parser* parser){
+    if(parser->structurals){
+        // only whitespace may sit between the end of a token and the next token start
+        size_t end = parser->position;
+        parser->position = parser->structurals[parser->next_structural++];
+        for(size_t i = end; i < parser->position; i++){
+            if(!cjson_is_whitespace[(uint8_t)parser->json[i]]){
+                CjsonToken tok = { .type = TOKEN_ERROR, .start = &parser->json[i], .length = 1 };
+                parser->position = i;
+                parser->current = tok;
+                return;
+            }
         }
-        arrput(json->array, child);
-    } else {
-        fprintf(stderr, "Cannot add child to non-object/array\n");
     }
+    parser->current = cjson_next_token(parser->json, &parser->position);
+    CJSON_STAT(cjson_stats_state.tokens[parser->current.type]++);
 }
 
-bool json_remove_child(JsonValue* json, JsonValue key){
-    if(key.type == JSON_STRING){
-        if(json->type != JSON_OBJECT){
-            fprintf(stderr, "Cannot remove string key from non object json!\n");
-            return 1;
-        }
-        return shdel(json->object, key.string);
-    }else if(key.type == JSON_NUMBER){
-        if(json->type != JSON_ARRAY){
-            fprintf(stderr, "Cannot remove number key from non array json!\n");
-            return 1;
-        }
-        arrdel(json->array, (size_t)key.number);
-        return 0;
+static void cjson_parser_init_tokens(Parser* parser, CjsonToken* tokens, JsonArena* arena){
+    parser->tokens = tokens;
+    parser->index = 0;
+    parser->arena = arena;
+    parser->insitu = false;
+    parser->keys = NULL;
+    parser->json = NULL;
+    parser->position = 0;
+    parser->structurals = NULL;
+    parser->next_structural = 0;
+    if(arrlenu(tokens) > 0){
+        parser->current = tokens[0];
+    }else{
+        CjsonToken eof = { .type = TOKEN_EOF, .start = NULL, .length = 0 };
+        parser->current = eof;
     }
-    fprintf(stderr, "Cannot remove key from non array or object json!\n");
-    return 1;
 }
 
+static void cjson_parser_init_stream(Parser* parser, char* json, const uint32_t* structurals, JsonArena* arena){
+    parser->tokens = NULL;
+    parser->index = 0;
+    parser->arena = arena;
+    parser->insitu = false;
+    parser->keys = NULL;
+    parser->json = json;
+    parser->position = 0;
+    parser->structurals = structurals;
+    parser->next_structural = 0;
+    cjson_parser_next_token(parser);
+}
 
-bool json_remove_key(JsonValue* json, const char* key){
-    if(json->type != JSON_OBJECT){
-        fprintf(stderr, "Cannot remove string key from non object json!\n");
-        return 1;
+static JsonValue* cjson_alloc_node(JsonArena* arena){
+    if(arena){
+        return json_arena_alloc_aligned(arena, sizeof(JsonValue), alignof(JsonValue));
     }
-    return shdel(json->object, key);
+    CJSON_STAT_ALLOC(sizeof(JsonValue));
+    return malloc(sizeof(JsonValue));
 }
 
-bool json_remove_at(JsonValue* json, size_t index){
-    if(json->type != JSON_ARRAY){
-        fprintf(stderr, "Cannot remove number key from non array json!\n");
-        return 1;
-    }
-    arrdel(json->array, index);
-    return 0;
+static JsonValue* cjson_new_node(Parser* parser){
+    return cjson_alloc_node(parser->arena);
 }
 
+// Arena containers are remembered so their stb_ds storage can be released without walking the tree
+static void cjson_track_container(Parser* parser, JsonValue* container){
+    if(parser->arena){
+        arrput(parser->arena->containers, container);
+    }
+}
 
-JsonValue* json_new_string(const char* str){
-    size_t len = strlen(str);
-    char* copy = malloc((len+1)*sizeof(char));
+// Copies a string token's body out of the input with its escapes decoded.
+// In-situ parsers decode it where it is and terminate it over the closing quote.
+static char* cjson_decode_string(Parser* parser, CjsonToken token, size_t* length){
+    char* copy;
+    if(parser->insitu){
+        copy = (char*)token.start;
+    }else if(parser->arena){
+        copy = json_arena_alloc_aligned(parser->arena, token.length + 1, 1);
+    }else{
+        CJSON_STAT_ALLOC(token.length + 1);
+        copy = malloc((token.length+1)*sizeof(char));
+    }
+    size_t decoded;
+    if(!cjson_unescape(token.start, token.length, copy, &decoded)){
+        printf("Invalid escape in string: \"%.*s\"\n", (int)token.length, token.start);
+        exit(1);
+    }
+    if(length) *length = decoded;
+    return copy;
+}
 
-    if(copy == NULL){
-        fprintf(stderr, "Could not duplicate string\n");
-        return NULL;
+// The interned copy of a key token; only escaped keys are decoded first
+static char* cjson_intern_key(Parser* parser, CjsonToken token){
+    if(!memchr(token.start, '\\', token.length)){
+        return (char*)json_key_intern(parser->keys, token.start, token.length);
     }
-    memcpy(copy, str, len);
-    copy[len] = '\0';
+    char* decoded = malloc(token.length + 1);
+    size_t length;
+    if(!cjson_unescape(token.start, token.length, decoded, &length)){
+        printf("Invalid escape in string: \"%.*s\"\n", (int)token.length, token.start);
+        exit(1);
+    }
+    char* key = (char*)json_key_intern(parser->keys, decoded, length);
+    free(decoded);
+    return key;
+}
 
-    JsonValue* json_string = malloc(sizeof(JsonValue));
-    json_string->type = JSON_STRING;
-    json_string->string = copy;
-    return json_string;
+static inline uint32_t cjson_string_length_field(size_t length){
+    return length <= UINT32_MAX ? (uint32_t)length : 0;
 }
 
-JsonValue* json_new_nstring(const char* str, size_t n) {
-    char* copy = malloc((n+1)*sizeof(char));
+
+void advance(Parser* parser) {
+    if (parser->current.type == TOKEN_EOF) {
+        return;
+    }
+    parser->index++;
+
+    if (parser->tokens) {
+        size_t len = arrlenu(parser->tokens);
+        if (parser->index >= len) {
+            printf("Parser index %lu out of bounds (len=%lu)\n", (long int)parser->index, (long int)len);
+            CjsonToken t = { .type = TOKEN_EOF, .start = NULL, .length = 0 };
+            parser->current = t;
+            return;
+        }
+        parser->current = parser->tokens[parser->index];
+        return;
+    }
+
+    cjson_parser_next_token(parser);
+    if (parser->current.type == TOKEN_ERROR) {
+        printf("Hit error at token %li. At file_content index %li\n",
+               (long int)parser->index, (long int)parser->position);
+    }
+}
+
+void parse_object(Parser* parser, JsonValue* json_object);
+void parse_array(Parser* parser, JsonValue* json_object);
+CjsonToken get_current_token(Parser* parser);
+
+
+JsonValue parse_value(Parser* parser){
+    CjsonToken token = parser->current;
+
+    JsonValue value;
+    value.flags = 0;
+    value.length = 0;
+
+    switch(token.type){
+        case TOKEN_CJSON_STRING:
+            value.type = JSON_STRING;
+            size_t length;
+            value.string = cjson_decode_string(parser, token, &length);
+            value.length = cjson_string_length_field(length);
+            if(parser->insitu) value.flags |= JSON_FLAG_BORROWED;
+            advance(parser);
+            break;
+        case TOKEN_NUMBER:
+            cjson_number_from_token(token.start, token.length, &value);
+            advance(parser);
+            break;
+        case TOKEN_TRUE:
+            value.type = JSON_BOOL;
+            value.boolean = 1;
+            advance(parser);
+            break;
+        case TOKEN_FALSE:
+            value.type = JSON_BOOL;
+            value.boolean = 0;
+            advance(parser);
+            break;
+        case TOKEN_NULL:
+            value.type = JSON_NULL;
+            advance(parser);
+            break;
+        case TOKEN_LEFT_BRACE:
+            parse_object(parser, &value);
+            break;
+        case TOKEN_LEFT_BRACKET:
+            parse_array(parser, &value);
+            break;
+        default:
+            printf("Unexpected token: %.*s type=%u\n", (int)token.length, token.start, token.type);
+            exit(1);
+    }
+    // containers count themselves
+    if(value.type < JSON_ARRAY) CJSON_STAT(cjson_stats_state.nodes[value.type]++);
+    return value;
+}
+
+// Parses the current value straight into its final node, so containers keep a stable address
+static JsonValue* parse_child(Parser* parser){
+    JsonValue* child = cjson_new_node(parser);
+    switch(get_current_token(parser).type){
+        case TOKEN_LEFT_BRACE:
+            cjson_track_container(parser, child);
+            parse_object(parser, child);
+            break;
+        case TOKEN_LEFT_BRACKET:
+            cjson_track_container(parser, child);
+            parse_array(parser, child);
+            break;
+        default:
+            *child = parse_value(parser);
+            break;
+    }
+    return child;
+}
+
+CjsonToken get_current_token(Parser* parser) {
+    return parser->current;
+}
+
+void parse_object(Parser* parser, JsonValue* json_object) {
+    json_object->type = JSON_OBJECT;
+    json_object->flags = 0;
+    json_object->object = NULL;
+    CJSON_STAT(cjson_stats_state.nodes[JSON_OBJECT]++; cjson_stats_enter());
+    CjsonKeyScratch seen = { NULL, 0 };
+
+    advance(parser); // skip "{"
+
+    while (get_current_token(parser).type != TOKEN_RIGHT_BRACE) {
+        CjsonToken key_token = get_current_token(parser);
+
+        if (key_token.type != TOKEN_CJSON_STRING) {
+            printf("Expected string key but %s found. at %lu\n", token_type_to_string(key_token.type), (long int)parser->index);
+            exit(1);
+        }
+
+        char* key = parser->keys ? cjson_intern_key(parser, key_token) : cjson_decode_string(parser, key_token, NULL);
+        advance(parser);
+
+        if (get_current_token(parser).type != TOKEN_COLON) {
+            printf("Expected ':'\n");
+            exit(1);
+        }
+
+        advance(parser);
+
+        JsonValue* heap_value = parse_child(parser);
+        if(parser->insitu || parser->keys) heap_value->flags |= JSON_FLAG_KEY_BORROWED;
+        if(!json_object->object) json_object->object = cjson_object_new(parser->arena);
+        ptrdiff_t existing = cjson_key_scratch_find(&seen, json_object->object, key);
+        if(existing >= 0){
+            // a repeated key keeps the last value
+            JsonPair* pair = &json_object->object->pairs[existing];
+            if(!parser->arena){
+                json_free(pair->value);
+                if(!(heap_value->flags & JSON_FLAG_KEY_BORROWED)) free(key);
+            }
+            pair->value = heap_value;
+        }else{
+            cjson_object_append(json_object->object, key, heap_value);
+        }
+
+        if (get_current_token(parser).type == TOKEN_COMMA) {
+            advance(parser);
+        } else if (get_current_token(parser).type != TOKEN_RIGHT_BRACE) {
+            printf("Expected ',' or '}'\n");
+            exit(1);
+        }
+    }
+
+    advance(parser); // Skip '}'
+    free(seen.slots);
+    CJSON_STAT(cjson_stats_leave());
+}
+
+void parse_array(Parser* parser, JsonValue* json_object) {
+    json_object->type = JSON_ARRAY;
+    json_object->flags = 0;
+    json_object->array = NULL;
+    CJSON_STAT(cjson_stats_state.nodes[JSON_ARRAY]++; cjson_stats_enter());
+
+    advance(parser); // Skip '['
+
+    while (get_current_token(parser).type != TOKEN_RIGHT_BRACKET) {
+        JsonValue* heap_value = parse_child(parser);
+        arrput(json_object->array, heap_value);
+
+        if (get_current_token(parser).type == TOKEN_COMMA) {
+            advance(parser);
+        } else if (get_current_token(parser).type != TOKEN_RIGHT_BRACKET) {
+            printf("Expected ',' or ']'\n");
+            exit(1);
+        }
+    }
+
+    advance(parser); // Skip ']'
+    CJSON_STAT(cjson_stats_leave());
+}
+
+static void cjson_parse_root(Parser* parser, JsonValue* output);
+
+void parse_json(CjsonToken* tokens, JsonValue* output) {
+    Parser parser;
+    cjson_parser_init_tokens(&parser, tokens, NULL);
+    cjson_parse_root(&parser, output);
+}
+
+void parse_json_arena(CjsonToken* tokens, JsonValue* output, JsonArena* arena) {
+    Parser parser;
+    cjson_parser_init_tokens(&parser, tokens, arena);
+    cjson_parse_root(&parser, output);
+}
+
+// Single pass: the lexer runs just ahead of the parser, one token at a time
+void parse_json_stream(char* json, JsonValue* output, JsonArena* arena) {
+    Parser parser;
+    cjson_parser_init_stream(&parser, json, NULL, arena);
+    cjson_parse_root(&parser, output);
+}
+
+// Runs the vectorized stage 1 first and then hops from token start to token start
+void parse_json_indexed(char* json, size_t length, JsonValue* output, JsonArena* arena) {
+    uint32_t* structurals = cjson_index_structurals(json, length);
+    Parser parser;
+    cjson_parser_init_stream(&parser, json, structurals, arena);
+    cjson_parse_root(&parser, output);
+    arrfree(structurals);
+}
+
+static void cjson_parse_root(Parser* parser, JsonValue* output) {
+    CJSON_STAT_START(start);
+    cjson_track_container(parser, output);
+
+    if (parser->current.type == TOKEN_LEFT_BRACE) {
+        parse_object(parser, output);
+    } else if (parser->current.type == TOKEN_LEFT_BRACKET) {
+        parse_array(parser, output);
+    } else {
+        printf("error: root must be object or array\n");
+        exit(1);
+    }
+
+    // After parsing, we should be at EOF
+    if (get_current_token(parser).type != TOKEN_EOF) {
+        printf("warning: extra tokens after root JSON value at index %lu\n", (long int)parser->index);
+    }
+    // token arrays were already counted by tokenize
+    if(parser->json) CJSON_STAT(cjson_stats_state.bytes += parser->position);
+    CJSON_STAT_STOP(start, parse_ns);
+}
+
+// Parallel parsing of one huge root array. A stage 1 pre-scan (quote aware,
+// so brackets and commas inside strings don't count) cuts the array at
+// top-level commas into chunks of whole elements; workers parse chunks into
+// their own lists and the lists are stitched into the root array in order.
+#ifndef CJSON_PARALLEL_MIN_CHUNK
+    #define CJSON_PARALLEL_MIN_CHUNK (256 * 1024)
+#endif
+
+// Offsets where chunks of root array elements start, about stride bytes apart,
+// plus the offset of the closing ']' as the last entry. NULL if the root is
+// not an array or its brackets don't balance.
+static size_t* cjson_split_root_array(const char* json, size_t length, size_t stride){
+    size_t* starts = NULL;
+    CjsonStage1State state = {0, 0, 0};
+    size_t depth = 0;
+    size_t next_split = stride;
+    bool root_seen = false;
+
+    for (size_t offset = 0; offset < length; offset += 64) {
+        uint8_t padded[64];
+        const uint8_t* block = (const uint8_t*)json + offset;
+        if (length - offset < 64) {
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, length - offset);
+            block = padded;
+        }
+
+        uint64_t bits = cjson_stage1_block(block, &state);
+        while (bits) {
+            size_t at = offset + cjson_ctz64(bits);
+            bits &= bits - 1;
+            switch (json[at]) {
+                case '[':
+                    if (!root_seen) {
+                        root_seen = true;
+                        arrput(starts, at + 1);
+                    }
+                    depth++;
+                    break;
+                case '{':
+                    if (!root_seen) goto malformed; // object roots aren't split
+                    depth++;
+                    break;
+                case ']':
+                case '}':
+                    if (depth == 0) goto malformed;
+                    if (--depth == 0) {
+                        arrput(starts, at);
+                        return starts;
+                    }
+                    break;
+                case ',':
+                    if (depth == 1 && at >= next_split) {
+                        arrput(starts, at + 1);
+                        next_split = at + stride;
+                    }
+                    break;
+                default:
+                    if (!root_seen) goto malformed;
+                    break;
+            }
+        }
+    }
+
+malformed:
+    arrfree(starts);
+    return NULL;
+}
+
+// Parses the elements in [start, end) of a root array; end is a split comma or the closing ']'
+static JsonValue** cjson_parse_array_chunk(char* json, size_t start, size_t end, JsonArena* arena){
+    JsonValue** elements = NULL;
+    Parser parser;
+    cjson_parser_init_stream(&parser, json + start, NULL, arena);
+    if (parser.current.type == TOKEN_RIGHT_BRACKET) {
+        return elements; // []
+    }
+
+    while (true) {
+        arrput(elements, parse_child(&parser));
+        size_t at = start + (size_t)(parser.current.start - (json + start));
+        if (at >= end) break;
+        if (parser.current.type != TOKEN_COMMA) {
+            printf("Expected ',' or ']'\n");
+            exit(1);
+        }
+        advance(&parser);
+    }
+    return elements;
+}
+
+typedef struct {
+    char* json;
+    const size_t* starts;
+    size_t chunks;
+    size_t next_chunk;     // claimed with an atomic add
+    JsonValue*** results;  // elements of each chunk
+} CjsonParallelJob;
+
+typedef struct {
+    CjsonParallelJob* job;
+    JsonArena* arena;
+} CjsonParallelWorker;
+
+static void* cjson_parallel_worker(void* argument){
+    CjsonParallelWorker* worker = argument;
+    CjsonParallelJob* job = worker->job;
+    while (true) {
+        size_t chunk = __atomic_fetch_add(&job->next_chunk, 1, __ATOMIC_RELAXED);
+        if (chunk >= job->chunks) break;
+        // a split comma belongs to the chunk before it
+        size_t end = job->starts[chunk + 1] - (chunk + 1 < job->chunks ? 1 : 0);
+        job->results[chunk] = cjson_parse_array_chunk(job->json, job->starts[chunk], end, worker->arena);
+    }
+    return NULL;
+}
+
+// Parses json (length bytes, NUL-terminated) with threads workers (0 = one per
+// online CPU) when its root is an array; other documents take the regular
+// single-threaded path. With arenas, worker i allocates from arenas[i], so
+// arenas must hold threads entries and threads must not be 0; the document is
+// then released by freeing all of them.
+void parse_json_parallel(char* json, size_t length, JsonValue* output, size_t threads, JsonArena* arenas) {
+#ifdef CJSON_THREADS
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+#else
+    if (threads == 0) threads = 1;
+#endif
+
+    size_t stride = length / (threads * 8);
+    if (stride < CJSON_PARALLEL_MIN_CHUNK) stride = CJSON_PARALLEL_MIN_CHUNK;
+    size_t* starts = threads > 1 ? cjson_split_root_array(json, length, stride) : NULL;
+    if (!starts) {
+        parse_json_stream(json, output, arenas);
+        return;
+    }
+
+    CjsonParallelJob job;
+    job.json = json;
+    job.starts = starts;
+    job.chunks = arrlenu(starts) - 1;
+    job.next_chunk = 0;
+    job.results = calloc(job.chunks, sizeof(JsonValue**));
+
+    CjsonParallelWorker* workers = malloc(threads * sizeof(CjsonParallelWorker));
+    for (size_t i = 0; i < threads; i++) {
+        workers[i].job = &job;
+        workers[i].arena = arenas ? &arenas[i] : NULL;
+    }
+
+#ifdef CJSON_THREADS
+    // the calling thread works as worker 0
+    size_t started = 0;
+    pthread_t* threads_started = malloc(threads * sizeof(pthread_t));
+    while (started + 1 < threads &&
+           pthread_create(&threads_started[started], NULL, cjson_parallel_worker, &workers[started + 1]) == 0) {
+        started++;
+    }
+#endif
+    cjson_parallel_worker(&workers[0]);
+#ifdef CJSON_THREADS
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads_started[i], NULL);
+    }
+    free(threads_started);
+#endif
+
+    output->type = JSON_ARRAY;
+    output->flags = 0;
+    output->length = 0;
+    output->array = NULL;
+    if (arenas) arrput(arenas[0].containers, output);
+    size_t total = 0;
+    for (size_t i = 0; i < job.chunks; i++) {
+        total += arrlenu(job.results[i]);
+    }
+    if (total) {
+        arrsetcap(output->array, total);
+        for (size_t i = 0; i < job.chunks; i++) {
+            size_t count = arrlenu(job.results[i]);
+            if (count) memcpy(arraddnptr(output->array, count), job.results[i], count * sizeof(JsonValue*));
+            arrfree(job.results[i]);
+        }
+    }
+
+    size_t close = starts[job.chunks] + 1;
+    while (cjson_is_whitespace[(uint8_t)json[close]]) close++;
+    if (json[close] != '\0') {
+        printf("warning: extra tokens after root JSON value at index %lu\n", (long int)close);
+    }
+
+    free(workers);
+    free(job.results);
+    arrfree(starts);
+}
+
+
+
+#ifndef CJSON_WRITER_BUFFER_SIZE
+    #define CJSON_WRITER_BUFFER_SIZE (64 * 1024)
+#endif
+
+// Receives serialized bytes; returns false to abort the write
+typedef bool (*JsonWriteFn)(void* context, const char* data, size_t length);
+
+// Growable output buffer. Without a sink everything accumulates in buffer,
+// with one the buffer is flushed to it whenever it fills up.
+typedef struct {
+    char* buffer;
+    size_t length;
+    size_t capacity;
+    JsonWriteFn sink;
+    void* context;
+    bool failed;
+} JsonWriter;
+
+void json_writer_init(JsonWriter* writer){
+    writer->buffer = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+    writer->sink = NULL;
+    writer->context = NULL;
+    writer->failed = false;
+}
+
+void json_writer_init_sink(JsonWriter* writer, JsonWriteFn sink, void* context){
+    json_writer_init(writer);
+    writer->sink = sink;
+    writer->context = context;
+}
+
+static bool cjson_file_sink(void* context, const char* data, size_t length){
+    return fwrite(data, 1, length, (FILE*)context) == length;
+}
+
+void json_writer_init_file(JsonWriter* writer, FILE* fp){
+    json_writer_init_sink(writer, cjson_file_sink, fp);
+}
+
+#ifdef CJSON_POSIX
+static bool cjson_fd_sink(void* context, const char* data, size_t length){
+    int fd = (int)(intptr_t)context;
+    while(length > 0){
+        ssize_t written = write(fd, data, length);
+        if(written < 0){
+            if(errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+void json_writer_init_fd(JsonWriter* writer, int fd){
+    json_writer_init_sink(writer, cjson_fd_sink, (void*)(intptr_t)fd);
+}
+#endif
+
+// Hands everything buffered so far to the sink. A no-op for in-memory writers.
+bool json_writer_flush(JsonWriter* writer){
+    if(!writer->sink || writer->length == 0) return !writer->failed;
+    if(!writer->failed && !writer->sink(writer->context, writer->buffer, writer->length)){
+        writer->failed = true;
+    }
+    writer->length = 0;
+    return !writer->failed;
+}
+
+// Makes room for n more bytes and returns where they go
+static char* cjson_writer_reserve(JsonWriter* writer, size_t n){
+    if(writer->length + n > writer->capacity && writer->sink){
+        json_writer_flush(writer);
+    }
+    if(writer->length + n > writer->capacity){
+        size_t capacity = writer->capacity ? writer->capacity * 2 : (writer->sink ? CJSON_WRITER_BUFFER_SIZE : 256);
+        while(capacity < writer->length + n){
+            capacity *= 2;
+        }
+        char* grown = realloc(writer->buffer, capacity);
+        if(!grown){
+            fprintf(stderr, "Could not grow writer buffer\n");
+            exit(1);
+        }
+        writer->buffer = grown;
+        writer->capacity = capacity;
+    }
+    return writer->buffer + writer->length;
+}
+
+void json_writer_append(JsonWriter* writer, const char* data, size_t length){
+    memcpy(cjson_writer_reserve(writer, length), data, length);
+    writer->length += length;
+}
+
+static inline void cjson_writer_char(JsonWriter* writer, char c){
+    if(writer->length == writer->capacity){
+        cjson_writer_reserve(writer, 1);
+    }
+    writer->buffer[writer->length++] = c;
+}
+
+#define cjson_writer_literal(writer, literal) json_writer_append((writer), (literal), sizeof(literal) - 1)
+
+static void cjson_writer_indent(JsonWriter* writer, size_t count){
+    memset(cjson_writer_reserve(writer, count), ' ', count);
+    writer->length += count;
+}
+
+static void cjson_write_number(JsonWriter* writer, const JsonValue* json){
+    char* dst = cjson_writer_reserve(writer, CJSON_NUMBER_BUFFER_SIZE);
+    writer->length += json_format_number(json, dst);
+}
+
+// Byte length of a JSON_STRING value
+size_t json_string_length(const JsonValue* json){
+    if(json->length || json->string[0] == '\0') return json->length;
+    return strlen(json->string);
+}
+
+static const char cjson_hex_digits[] = "0123456789abcdef";
+
+// Quotes and escapes str[0..length): runs of plain bytes are copied whole,
+// only '"', '\\' and control characters are rewritten
+static void cjson_write_string(JsonWriter* writer, const char* str, size_t length){
+    cjson_writer_char(writer, '"');
+    size_t i = 0;
+    while(true){
+        size_t next = cjson_find_escape_char(str, i, length);
+        if(next > i){
+            json_writer_append(writer, str + i, next - i);
+        }
+        if(next >= length) break;
+
+        char* dst = cjson_writer_reserve(writer, 6);
+        uint8_t c = (uint8_t)str[next];
+        size_t n = 2;
+        dst[0] = '\\';
+        switch(c){
+            case '"':  dst[1] = '"';  break;
+            case '\\': dst[1] = '\\'; break;
+            case '\b': dst[1] = 'b';  break;
+            case '\f': dst[1] = 'f';  break;
+            case '\n': dst[1] = 'n';  break;
+            case '\r': dst[1] = 'r';  break;
+            case '\t': dst[1] = 't';  break;
+            default:
+                dst[1] = 'u';
+                dst[2] = '0';
+                dst[3] = '0';
+                dst[4] = cjson_hex_digits[c >> 4];
+                dst[5] = cjson_hex_digits[c & 0xF];
+                n = 6;
+                break;
+        }
+        writer->length += n;
+        i = next + 1;
+    }
+    cjson_writer_char(writer, '"');
+}
+
+// Compact serialization, same output as json_dump
+void json_write(JsonWriter* writer, const JsonValue* json){
+    switch (json->type) {
+        case JSON_OBJECT: {
+            cjson_writer_char(writer, '{');
+            size_t count = cjson_object_count(json->object);
+            for (size_t i = 0; i < count; i++) {
+                const JsonPair* pair = &json->object->pairs[i];
+                if (i > 0) cjson_writer_char(writer, ',');
+                cjson_write_string(writer, pair->key, strlen(pair->key));
+                cjson_writer_char(writer, ':');
+                json_write(writer, pair->value);
+            }
+            cjson_writer_char(writer, '}');
+            break;
+        }
+        case JSON_ARRAY: {
+            cjson_writer_char(writer, '[');
+            JsonValue **values = json->array;
+            size_t count = arrlenu(values);
+            for (size_t i = 0; i < count; i++) {
+                if (i > 0) cjson_writer_char(writer, ',');
+                json_write(writer, values[i]);
+            }
+            cjson_writer_char(writer, ']');
+            break;
+        }
+        case JSON_STRING:
+            cjson_write_string(writer, json->string, json_string_length(json));
+            break;
+        case JSON_NUMBER:
+            cjson_write_number(writer, json);
+            break;
+        case JSON_BOOL:
+            if (json->boolean) cjson_writer_literal(writer, "true");
+            else cjson_writer_literal(writer, "false");
+            break;
+        case JSON_NULL:
+            cjson_writer_literal(writer, "null");
+            break;
+    }
+}
+
+// Indented serialization, same layout as json_print
+void json_write_pretty(JsonWriter* writer, const JsonValue* json, size_t spaces, size_t depth){
+    switch (json->type) {
+        case JSON_OBJECT: {
+            cjson_writer_literal(writer, "{\n");
+            size_t count = cjson_object_count(json->object);
+            for (size_t i = 0; i < count; i++) {
+                const JsonPair* pair = &json->object->pairs[i];
+                cjson_writer_indent(writer, (depth + 1) * spaces);
+                cjson_write_string(writer, pair->key, strlen(pair->key));
+                cjson_writer_literal(writer, ": ");
+                json_write_pretty(writer, pair->value, spaces, depth + 1);
+                if (i < count - 1) cjson_writer_char(writer, ',');
+                cjson_writer_char(writer, '\n');
+            }
+            cjson_writer_indent(writer, depth * spaces);
+            cjson_writer_char(writer, '}');
+            break;
+        }
+        case JSON_ARRAY: {
+            cjson_writer_literal(writer, "[\n");
+            JsonValue** values = json->array;
+            size_t count = arrlenu(values);
+            for (size_t i = 0; i < count; i++) {
+                cjson_writer_indent(writer, (depth + 1) * spaces);
+                json_write_pretty(writer, values[i], spaces, depth + 1);
+                if (i < count - 1) cjson_writer_char(writer, ',');
+                cjson_writer_char(writer, '\n');
+            }
+            cjson_writer_indent(writer, depth * spaces);
+            cjson_writer_char(writer, ']');
+            break;
+        }
+        default:
+            json_write(writer, json);
+            break;
+    }
+}
+
+void json_writer_free(JsonWriter* writer){
+    free(writer->buffer);
+    json_writer_init_sink(writer, writer->sink, writer->context);
+}
+
+// Detaches the in-memory output as a NUL-terminated string owned by the caller (free it with free)
+char* json_writer_take(JsonWriter* writer){
+    cjson_writer_char(writer, '\0');
+    char* out = writer->buffer;
+    json_writer_init_sink(writer, writer->sink, writer->context);
+    return out;
+}
+
+// Appends the compact form of json to the stb_ds char array *out (not NUL-terminated)
+void json_dump(JsonValue *json, char **out) {
+    CJSON_STAT_START(start);
+    JsonWriter writer;
+    json_writer_init(&writer);
+    json_write(&writer, json);
+    CJSON_STAT(cjson_stats_state.output_bytes += writer.length);
+    if (writer.length) {
+        memcpy(arraddnptr(*out, writer.length), writer.buffer, writer.length);
+    }
+    json_writer_free(&writer);
+    CJSON_STAT_STOP(start, dump_ns);
+}
+
+// Compact form of json as a NUL-terminated string, release it with free
+char* json_dump_string(const JsonValue* json) {
+    CJSON_STAT_START(start);
+    JsonWriter writer;
+    json_writer_init(&writer);
+    json_write(&writer, json);
+    CJSON_STAT(cjson_stats_state.output_bytes += writer.length);
+    char* out = json_writer_take(&writer);
+    CJSON_STAT_STOP(start, dump_ns);
+    return out;
+}
+
+void json_print(JsonValue* json, size_t spaces, size_t depth) {
+    JsonWriter writer;
+    json_writer_init_file(&writer, stdout);
+    json_write_pretty(&writer, json, spaces, depth);
+    if (depth == 0) {
+        cjson_writer_char(&writer, '\n');
+    }
+    json_writer_flush(&writer);
+    json_writer_free(&writer);
+}
+
+static void cjson_free_value(JsonValue *value);
+
+// Releases what value owns but not value itself
+static void cjson_free_contents(JsonValue *value) {
+    switch (value->type) {
+        case JSON_ARRAY:
+            if (value->array) {
+                for (size_t i = 0; i < arrlenu(value->array); i++) {
+                    cjson_free_value(value->array[i]);
+                }
+                arrfree(value->array);
+            }
+            break;
+
+        case JSON_OBJECT:
+            if(value->object){
+                JsonPair* pairs = value->object->pairs;
+                for (size_t i = 0; i < arrlenu(pairs); i++) {
+                    if (!(pairs[i].value->flags & JSON_FLAG_KEY_BORROWED)) {
+                        free(pairs[i].key);
+                    }
+                    cjson_free_value(pairs[i].value);
+                }
+                cjson_object_release(value->object);
+                free(value->object);
+            }
+            break;
+
+        case JSON_STRING:
+            if (!(value->flags & JSON_FLAG_BORROWED)) {
+                free(value->string);
+            }
+            break;
+
+        case JSON_NUMBER:
+        case JSON_BOOL:
+        case JSON_NULL:
+            break;
+    }
+}
+
+static void cjson_free_value(JsonValue *value) {
+    if (!value) return;
+    cjson_free_contents(value);
+    free(value);
+}
+
+void json_free(JsonValue *value) {
+    CJSON_STAT_START(start);
+    cjson_free_value(value);
+    CJSON_STAT_STOP(start, free_ns);
+}
+
+// Escaped form of input without the surrounding quotes, release it with free
+char *json_escape(const char *input) {
+    if (!input) return NULL;
+
+    JsonWriter writer;
+    json_writer_init(&writer);
+    cjson_write_string(&writer, input, strlen(input));
+    cjson_writer_char(&writer, '\0');
+    // drop the quotes
+    memmove(writer.buffer, writer.buffer + 1, writer.length - 2);
+    writer.buffer[writer.length - 3] = '\0';
+    return writer.buffer;
+}
+
+// Decodes the escapes of a JSON string body, release it with free. NULL on a malformed escape.
+char *json_unescape(const char *input) {
+    if (!input) return NULL;
+
+    size_t len = strlen(input);
+    char *unescaped = malloc(len + 1);
+    if (!unescaped) return NULL;
+
+    size_t decoded;
+    if (!cjson_unescape(input, len, unescaped, &decoded)) {
+        free(unescaped);
+        return NULL;
+    }
+    return unescaped;
+}
+
+void jsonFileLoad(const char* file_name, JsonValue* output){
+    JsonMappedFile file;
+    if(!json_file_map(file_name, &file)){
+        return;
+    }
+    parse_json_stream(file.data, output, NULL);
+    json_file_unmap(&file);
+}
+
+void jsonStringLoad(char* json_string, JsonValue* output){
+    parse_json_stream(json_string, output, NULL);
+}
+
+// Arena variants: the whole document is released with json_arena_free/json_arena_reset, never json_free
+void jsonFileLoadArena(const char* file_name, JsonValue* output, JsonArena* arena){
+    JsonMappedFile file;
+    if(!json_file_map(file_name, &file)){
+        return;
+    }
+    parse_json_stream(file.data, output, arena);
+    json_file_unmap(&file);
+}
+
+void jsonStringLoadArena(char* json_string, JsonValue* output, JsonArena* arena){
+    parse_json_stream(json_string, output, arena);
+}
+
+// Object keys come from keys, which may be shared by many documents and
+// must outlive them all. Works with or without an arena.
+void jsonStringLoadInterned(char* json_string, JsonValue* output, JsonArena* arena, JsonKeyTable* keys){
+    Parser parser;
+    cjson_parser_init_stream(&parser, json_string, NULL, arena);
+    parser.keys = keys;
+    cjson_parse_root(&parser, output);
+}
+
+// Splits a root array across threads workers, see parse_json_parallel
+void jsonFileLoadParallel(const char* file_name, JsonValue* output, size_t threads){
+    JsonMappedFile file;
+    if(!json_file_map(file_name, &file)){
+        return;
+    }
+    parse_json_parallel(file.data, file.length, output, threads, NULL);
+    json_file_unmap(&file);
+}
+
+// Strings and keys stay inside json, which is rewritten in place and must
+// outlive the document; escaped strings are decoded where they stand.
+// Works with or without an arena. Use json_file_map to parse a file this way.
+void jsonStringLoadInsitu(char* json_string, JsonValue* output, JsonArena* arena){
+    Parser parser;
+    cjson_parser_init_stream(&parser, json_string, NULL, arena);
+    parser.insitu = true;
+    cjson_parse_root(&parser, output);
+}
+
+// Event-driven parsing. The grammar checker below turns tokens into
+// callbacks and keeps only a byte per open container plus one reusable
+// buffer for decoded strings, so its memory does not grow with the document.
+// Any callback may be NULL; returning false from one stops the parse.
+typedef struct {
+    bool (*start_object)(void* context);
+    bool (*end_object)(void* context);
+    bool (*start_array)(void* context);
+    bool (*end_array)(void* context);
+    bool (*key)(void* context, const char* key, size_t length);       // decoded and NUL-terminated,
+    bool (*string)(void* context, const char* str, size_t length);    // valid only during the call
+    bool (*number)(void* context, const JsonValue* number);           // read with json_get_number/int64/uint64
+    bool (*boolean)(void* context, bool value);
+    bool (*null)(void* context);
+} JsonSaxHandler;
+
+typedef enum {
+    CJSON_GRAMMAR_VALUE,         // root, after ':' or after ',' in an array
+    CJSON_GRAMMAR_VALUE_OR_END,  // just after '['
+    CJSON_GRAMMAR_KEY,           // after ',' in an object
+    CJSON_GRAMMAR_KEY_OR_END,    // just after '{'
+    CJSON_GRAMMAR_COLON,
+    CJSON_GRAMMAR_COMMA_OR_END,
+    CJSON_GRAMMAR_DONE,
+} CjsonGrammarState;
+
+typedef struct {
+    const JsonSaxHandler* handler;
+    void* context;
+    CjsonGrammarState state;
+    JsonType* open;  // JSON_OBJECT or JSON_ARRAY per open container, innermost last
+    char* scratch;   // decoded strings for the key/string callbacks
+    JsonError error;
+} CjsonGrammar;
+
+static void cjson_grammar_init(CjsonGrammar* grammar, const JsonSaxHandler* handler, void* context){
+    grammar->handler = handler;
+    grammar->context = context;
+    grammar->state = CJSON_GRAMMAR_VALUE;
+    grammar->open = NULL;
+    grammar->scratch = NULL;
+    grammar->error.code = JSON_OK;
+    grammar->error.offset = 0;
+    grammar->error.message = NULL;
+}
+
+static void cjson_grammar_free(CjsonGrammar* grammar){
+    arrfree(grammar->open);
+    arrfree(grammar->scratch);
+}
+
+static bool cjson_grammar_fail(CjsonGrammar* grammar, JsonErrorCode code, size_t offset, const char* message){
+    grammar->error.code = code;
+    grammar->error.offset = offset;
+    grammar->error.message = message;
+    return false;
+}
+
+static bool cjson_grammar_unexpected(CjsonGrammar* grammar, size_t offset, const char* message){
+    return cjson_grammar_fail(grammar, grammar->state == CJSON_GRAMMAR_DONE ? JSON_ERROR_TRAILING : JSON_ERROR_SYNTAX,
+                              offset, message);
+}
+
+static bool cjson_grammar_cancelled(CjsonGrammar* grammar, size_t offset){
+    return cjson_grammar_fail(grammar, JSON_ERROR_CANCELLED, offset, "stopped by handler");
+}
+
+static void cjson_grammar_after_value(CjsonGrammar* grammar){
+    grammar->state = arrlenu(grammar->open) ? CJSON_GRAMMAR_COMMA_OR_END : CJSON_GRAMMAR_DONE;
+}
+
+static inline bool cjson_grammar_wants_value(const CjsonGrammar* grammar){
+    return grammar->state == CJSON_GRAMMAR_VALUE || grammar->state == CJSON_GRAMMAR_VALUE_OR_END;
+}
+
+// RFC 8259 number grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool cjson_number_is_valid(const char* str, size_t length){
+    size_t i = 0;
+    if (i < length && str[i] == '-') i++;
+    if (i >= length) return false;
+    if (str[i] == '0') {
+        i++;
+    } else if (str[i] >= '1' && str[i] <= '9') {
+        while (i < length && isdigit((uint8_t)str[i])) i++;
+    } else {
+        return false;
+    }
+    if (i < length && str[i] == '.') {
+        size_t digits = ++i;
+        while (i < length && isdigit((uint8_t)str[i])) i++;
+        if (i == digits) return false;
+    }
+    if (i < length && (str[i] == 'e' || str[i] == 'E')) {
+        i++;
+        if (i < length && (str[i] == '+' || str[i] == '-')) i++;
+        size_t digits = i;
+        while (i < length && isdigit((uint8_t)str[i])) i++;
+        if (i == digits) return false;
+    }
+    return i == length;
+}
+
+static bool cjson_grammar_structural(CjsonGrammar* grammar, char c, size_t offset){
+    const JsonSaxHandler* handler = grammar->handler;
+    bool ok = true;
+
+    switch (c) {
+        case '{':
+        case '[':
+            if (!cjson_grammar_wants_value(grammar)) break;
+            if (c == '{') {
+                arrput(grammar->open, JSON_OBJECT);
+                grammar->state = CJSON_GRAMMAR_KEY_OR_END;
+                if (handler->start_object) ok = handler->start_object(grammar->context);
+            } else {
+                arrput(grammar->open, JSON_ARRAY);
+                grammar->state = CJSON_GRAMMAR_VALUE_OR_END;
+                if (handler->start_array) ok = handler->start_array(grammar->context);
+            }
+            return ok ? true : cjson_grammar_cancelled(grammar, offset);
+        case ':':
+            if (grammar->state != CJSON_GRAMMAR_COLON) break;
+            grammar->state = CJSON_GRAMMAR_VALUE;
+            return true;
+        case ',':
+            if (grammar->state != CJSON_GRAMMAR_COMMA_OR_END) break;
+            grammar->state = arrlast(grammar->open) == JSON_OBJECT ? CJSON_GRAMMAR_KEY : CJSON_GRAMMAR_VALUE;
+            return true;
+        case '}':
+        case ']': {
+            JsonType closes = c == '}' ? JSON_OBJECT : JSON_ARRAY;
+            bool can_close = grammar->state == CJSON_GRAMMAR_COMMA_OR_END ||
+                             (closes == JSON_OBJECT && grammar->state == CJSON_GRAMMAR_KEY_OR_END) ||
+                             (closes == JSON_ARRAY && grammar->state == CJSON_GRAMMAR_VALUE_OR_END);
+            if (!can_close || arrlast(grammar->open) != closes) break;
+            (void)arrpop(grammar->open);
+            cjson_grammar_after_value(grammar);
+            if (closes == JSON_OBJECT) {
+                if (handler->end_object) ok = handler->end_object(grammar->context);
+            } else {
+                if (handler->end_array) ok = handler->end_array(grammar->context);
+            }
+            return ok ? true : cjson_grammar_cancelled(grammar, offset);
+        }
+    }
+    return cjson_grammar_unexpected(grammar, offset, "unexpected character");
+}
+
+// start/length is the string body without its quotes, escapes still in place
+static bool cjson_grammar_string(CjsonGrammar* grammar, const char* start, size_t length, size_t offset){
+    bool key = grammar->state == CJSON_GRAMMAR_KEY || grammar->state == CJSON_GRAMMAR_KEY_OR_END;
+    if (!key && !cjson_grammar_wants_value(grammar)) {
+        return cjson_grammar_unexpected(grammar, offset, "unexpected string");
+    }
+
+    if (arrcap(grammar->scratch) < length + 1) {
+        arrsetcap(grammar->scratch, length + 1);
+    }
+    size_t decoded;
+    if (!cjson_unescape(start, length, grammar->scratch, &decoded)) {
+        return cjson_grammar_fail(grammar, JSON_ERROR_STRING, offset, "invalid escape in string");
+    }
+
+    bool ok = true;
+    if (key) {
+        grammar->state = CJSON_GRAMMAR_COLON;
+        if (grammar->handler->key) ok = grammar->handler->key(grammar->context, grammar->scratch, decoded);
+    } else {
+        cjson_grammar_after_value(grammar);
+        if (grammar->handler->string) ok = grammar->handler->string(grammar->context, grammar->scratch, decoded);
+    }
+    return ok ? true : cjson_grammar_cancelled(grammar, offset);
+}
+
+// A number or keyword, already cut at the next delimiter
+static bool cjson_grammar_scalar(CjsonGrammar* grammar, const char* start, size_t length, size_t offset){
+    if (!cjson_grammar_wants_value(grammar)) {
+        return cjson_grammar_unexpected(grammar, offset, "unexpected value");
+    }
+
+    const JsonSaxHandler* handler = grammar->handler;
+    bool ok = true;
+    if (length == 4 && memcmp(start, "true", 4) == 0) {
+        if (handler->boolean) ok = handler->boolean(grammar->context, true);
+    } else if (length == 5 && memcmp(start, "false", 5) == 0) {
+        if (handler->boolean) ok = handler->boolean(grammar->context, false);
+    } else if (length == 4 && memcmp(start, "null", 4) == 0) {
+        if (handler->null) ok = handler->null(grammar->context);
+    } else if (isdigit((uint8_t)start[0]) || start[0] == '-') {
+        if (!cjson_number_is_valid(start, length)) {
+            return cjson_grammar_fail(grammar, JSON_ERROR_NUMBER, offset, "malformed number");
+        }
+        JsonValue number;
+        cjson_number_from_token(start, length, &number);
+        number.length = 0;
+        if (handler->number) ok = handler->number(grammar->context, &number);
+    } else {
+        return cjson_grammar_fail(grammar, JSON_ERROR_SYNTAX, offset, "invalid literal");
+    }
+    cjson_grammar_after_value(grammar);
+    return ok ? true : cjson_grammar_cancelled(grammar, offset);
+}
+
+static bool cjson_grammar_end(CjsonGrammar* grammar, size_t offset){
+    if (grammar->state != CJSON_GRAMMAR_DONE) {
+        return cjson_grammar_fail(grammar, JSON_ERROR_INCOMPLETE, offset, "unexpected end of input");
+    }
+    return true;
+}
+
+// Runs handler over a whole NUL-terminated document with the regular lexer.
+// Returns false on malformed input or when a callback stops the parse; error
+// (may be NULL) then says why and where.
+bool json_sax_parse(char* json, const JsonSaxHandler* handler, void* context, JsonError* error){
+    CjsonGrammar grammar;
+    cjson_grammar_init(&grammar, handler, context);
+
+    size_t position = 0;
+    bool ok = true;
+    bool done = false;
+    while (ok && !done) {
+        CjsonToken token = cjson_next_token(json, &position);
+        size_t offset = (size_t)(token.start - json);
+        switch (token.type) {
+            case TOKEN_EOF:
+                ok = cjson_grammar_end(&grammar, offset);
+                done = true;
+                break;
+            case TOKEN_LEFT_BRACE:
+            case TOKEN_RIGHT_BRACE:
+            case TOKEN_LEFT_BRACKET:
+            case TOKEN_RIGHT_BRACKET:
+            case TOKEN_COLON:
+            case TOKEN_COMMA:
+                ok = cjson_grammar_structural(&grammar, token.start[0], offset);
+                break;
+            case TOKEN_CJSON_STRING:
+                ok = cjson_grammar_string(&grammar, token.start, token.length, offset - 1);
+                break;
+            case TOKEN_NUMBER:
+            case TOKEN_TRUE:
+            case TOKEN_FALSE:
+            case TOKEN_NULL:
+                ok = cjson_grammar_scalar(&grammar, token.start, token.length, offset);
+                break;
+            default:
+                if (json[position] == '\0') {
+                    ok = cjson_grammar_fail(&grammar, JSON_ERROR_INCOMPLETE, offset, "unexpected end of input");
+                } else if (grammar.state != CJSON_GRAMMAR_DONE && (isdigit((uint8_t)json[offset]) || json[offset] == '-')) {
+                    ok = cjson_grammar_fail(&grammar, JSON_ERROR_NUMBER, offset, "malformed number");
+                } else {
+                    ok = cjson_grammar_unexpected(&grammar, offset, "invalid token");
+                }
+                break;
+        }
+    }
+
+    if (error) *error = grammar.error;
+    cjson_grammar_free(&grammar);
+    return ok;
+}
+
+// Validate-only mode: checks a document against the full RFC 8259 grammar,
+// number syntax and UTF-8 well-formedness without building anything or
+// allocating. The input is len bytes and need not be NUL-terminated; a NUL
+// inside it is an error like any other stray byte. Open containers are
+// tracked as one bit each, so nesting deeper than CJSON_VALIDATE_MAX_DEPTH
+// is rejected with JSON_ERROR_DEPTH. Escapes are checked the way the parsers decode them, so a
+// lone \u surrogate passes.
+#ifndef CJSON_VALIDATE_MAX_DEPTH
+    #define CJSON_VALIDATE_MAX_DEPTH 1024
+#endif
+
+// First byte in [index, length) that ends a plain run of string bytes:
+// '"', '\\', a control character or the start of a multi-byte sequence
+static size_t cjson_validate_scan_scalar(const uint8_t* json, size_t index, size_t length){
+    while (index < length && json[index] >= 0x20 && json[index] < 0x80 && json[index] != '"' && json[index] != '\\') {
+        index++;
+    }
+    return index;
+}
+
+#ifdef CJSON_X86_SIMD
+// Signed compares put every byte >= 0x80 below ' ' together with the controls
+static size_t cjson_validate_scan_sse2(const uint8_t* json, size_t index, size_t length){
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(' ');
+    while (length - index >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(json + index));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+            _mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)), _mm_cmplt_epi8(v, space)));
+        if (mask) return index + cjson_ctz64(mask);
+        index += 16;
+    }
+    return cjson_validate_scan_scalar(json, index, length);
+}
+
+CJSON_TARGET_AVX2 static size_t cjson_validate_scan_avx2(const uint8_t* json, size_t index, size_t length){
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i space = _mm256_set1_epi8(' ');
+    while (length - index >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(json + index));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+            _mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)), _mm256_cmpgt_epi8(space, v)));
+        if (mask) return index + cjson_ctz64(mask);
+        index += 32;
+    }
+    return cjson_validate_scan_scalar(json, index, length);
+}
+#endif
+
+static inline size_t cjson_validate_scan(const uint8_t* json, size_t index, size_t length){
+#ifdef CJSON_X86_SIMD
+    if (cjson_cpu_has_avx2()) return cjson_validate_scan_avx2(json, index, length);
+    return cjson_validate_scan_sse2(json, index, length);
+#else
+    return cjson_validate_scan_scalar(json, index, length);
+#endif
+}
+
+// Length of the well-formed UTF-8 sequence (RFC 3629) starting at json[index],
+// 0 for overlong forms, surrogates, code points past U+10FFFF and truncations
+static size_t cjson_utf8_sequence(const uint8_t* json, size_t index, size_t length){
+    uint8_t lead = json[index];
+    uint8_t low = 0x80, high = 0xBF;
+    size_t size;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        size = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        size = 3;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        size = 4;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else {
+        return 0;
+    }
+    if (length - index < size) return 0;
+    if (json[index + 1] < low || json[index + 1] > high) return 0;
+    for (size_t i = 2; i < size; i++) {
+        if ((json[index + i] & 0xC0) != 0x80) return 0;
+    }
+    return size;
+}
+
+static bool cjson_validate_fail(JsonError* error, JsonErrorCode code, size_t offset, const char* message){
+    error->code = code;
+    error->offset = offset;
+    error->message = message;
+    return false;
+}
+
+// *index is at the opening quote and moves past the closing one
+static bool cjson_validate_string(const uint8_t* json, size_t length, size_t* index, JsonError* error){
+    size_t i = *index + 1;
+    while (true) {
+        i = cjson_validate_scan(json, i, length);
+        if (i >= length) return cjson_validate_fail(error, JSON_ERROR_INCOMPLETE, length, "unterminated string");
+        uint8_t c = json[i];
+        if (c == '"') {
+            *index = i + 1;
+            return true;
+        }
+        if (c == '\\') {
+            if (length - i < 2) return cjson_validate_fail(error, JSON_ERROR_INCOMPLETE, length, "unterminated string");
+            switch (json[i + 1]) {
+                case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                    i += 2;
+                    break;
+                case 'u':
+                    if (length - i < 6) return cjson_validate_fail(error, JSON_ERROR_INCOMPLETE, length, "unterminated string");
+                    if (cjson_hex4((const char*)json + i + 2) < 0) {
+                        return cjson_validate_fail(error, JSON_ERROR_STRING, i, "malformed \\u escape");
+                    }
+                    i += 6;
+                    break;
+                default:
+                    return cjson_validate_fail(error, JSON_ERROR_STRING, i, "invalid escape in string");
+            }
+        } else if (c < 0x20) {
+            return cjson_validate_fail(error, JSON_ERROR_STRING, i, "control character in string");
+        } else {
+            size_t size = cjson_utf8_sequence(json, i, length);
+            if (!size) return cjson_validate_fail(error, JSON_ERROR_UTF8, i, "invalid UTF-8 in string");
+            i += size;
+        }
+    }
+}
+
+static inline bool cjson_is_digit(uint8_t c){
+    return c >= '0' && c <= '9';
+}
+
+// A number or keyword has to be followed by whitespace, ',', ']', '}' or the end
+static inline bool cjson_validate_delimited(const uint8_t* json, size_t index, size_t length){
+    if (index == length) return true;
+    uint8_t c = json[index];
+    return cjson_is_whitespace[c] || c == ',' || c == ']' || c == '}';
+}
+
+static bool cjson_validate_scalar(const uint8_t* json, size_t length, size_t* index, JsonError* error){
+    size_t start = *index;
+    uint8_t c = json[start];
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        // one pass over -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+        size_t i = start + (c == '-');
+        bool valid = i < length;
+        if (valid && json[i] == '0') {
+            i++;
+        } else if (valid && json[i] >= '1' && json[i] <= '9') {
+            while (i < length && cjson_is_digit(json[i])) i++;
+        } else {
+            valid = false;
+        }
+        if (valid && i < length && json[i] == '.') {
+            size_t digits = ++i;
+            while (i < length && cjson_is_digit(json[i])) i++;
+            valid = i > digits;
+        }
+        if (valid && i < length && (json[i] == 'e' || json[i] == 'E')) {
+            i++;
+            if (i < length && (json[i] == '+' || json[i] == '-')) i++;
+            size_t digits = i;
+            while (i < length && cjson_is_digit(json[i])) i++;
+            valid = i > digits;
+        }
+        if (!valid || !cjson_validate_delimited(json, i, length)) {
+            return cjson_validate_fail(error, JSON_ERROR_NUMBER, start, "malformed number");
+        }
+        *index = i;
+        return true;
+    }
+
+    const char* literal = c == 't' ? "true" : c == 'f' ? "false" : c == 'n' ? "null" : NULL;
+    if (!literal) return cjson_validate_fail(error, JSON_ERROR_SYNTAX, start, "unexpected character");
+    size_t size = strlen(literal);
+    size_t available = length - start < size ? length - start : size;
+    if (memcmp(json + start, literal, available) != 0) {
+        return cjson_validate_fail(error, JSON_ERROR_SYNTAX, start, "invalid literal");
+    }
+    if (available < size) return cjson_validate_fail(error, JSON_ERROR_INCOMPLETE, length, "unexpected end of input");
+    if (!cjson_validate_delimited(json, start + size, length)) {
+        return cjson_validate_fail(error, JSON_ERROR_SYNTAX, start, "invalid literal");
+    }
+    *index = start + size;
+    return true;
+}
+
+// Checks len bytes at buf as one JSON text. The result's code is JSON_OK for
+// a valid document; otherwise offset is the byte where it stops being one.
+JsonError json_validate(const char* buf, size_t len){
+    const uint8_t* json = (const uint8_t*)buf;
+    JsonError error = { JSON_OK, 0, NULL };
+    uint64_t objects[(CJSON_VALIDATE_MAX_DEPTH + 63) / 64]; // bit set for each open object, clear for arrays
+    size_t depth = 0;
+    CjsonGrammarState state = CJSON_GRAMMAR_VALUE;
+    size_t i = 0;
+
+    while (true) {
+        while (i < len && cjson_is_whitespace[json[i]]) i++;
+        if (i == len) break;
+        uint8_t c = json[i];
+        bool in_object = depth && (objects[(depth - 1) / 64] >> ((depth - 1) % 64) & 1);
+
+        switch (state) {
+            case CJSON_GRAMMAR_DONE:
+                cjson_validate_fail(&error, JSON_ERROR_TRAILING, i, "unexpected data after the root value");
+                return error;
+            case CJSON_GRAMMAR_COLON:
+                if (c != ':') {
+                    cjson_validate_fail(&error, JSON_ERROR_SYNTAX, i, "expected ':'");
+                    return error;
+                }
+                state = CJSON_GRAMMAR_VALUE;
+                i++;
+                continue;
+            case CJSON_GRAMMAR_COMMA_OR_END:
+                if (c == ',') {
+                    state = in_object ? CJSON_GRAMMAR_KEY : CJSON_GRAMMAR_VALUE;
+                    i++;
+                    continue;
+                }
+                if (c != (in_object ? '}' : ']')) {
+                    cjson_validate_fail(&error, JSON_ERROR_SYNTAX, i, in_object ? "expected ',' or '}'" : "expected ',' or ']'");
+                    return error;
+                }
+                break; // closes below
+            case CJSON_GRAMMAR_KEY:
+            case CJSON_GRAMMAR_KEY_OR_END:
+                if (c == '}' && state == CJSON_GRAMMAR_KEY_OR_END) break;
+                if (c != '"') {
+                    cjson_validate_fail(&error, JSON_ERROR_SYNTAX, i, "expected string key");
+                    return error;
+                }
+                if (!cjson_validate_string(json, len, &i, &error)) return error;
+                state = CJSON_GRAMMAR_COLON;
+                continue;
+            case CJSON_GRAMMAR_VALUE:
+            case CJSON_GRAMMAR_VALUE_OR_END:
+                if (c == ']' && state == CJSON_GRAMMAR_VALUE_OR_END) break;
+                if (c == '{' || c == '[') {
+                    if (depth == CJSON_VALIDATE_MAX_DEPTH) {
+                        cjson_validate_fail(&error, JSON_ERROR_DEPTH, i, "nesting too deep");
+                        return error;
+                    }
+                    uint64_t bit = (uint64_t)1 << (depth % 64);
+                    if (c == '{') objects[depth / 64] |= bit; else objects[depth / 64] &= ~bit;
+                    depth++;
+                    state = c == '{' ? CJSON_GRAMMAR_KEY_OR_END : CJSON_GRAMMAR_VALUE_OR_END;
+                    i++;
+                    continue;
+                }
+                if (c == '"') {
+                    if (!cjson_validate_string(json, len, &i, &error)) return error;
+                } else if (!cjson_validate_scalar(json, len, &i, &error)) {
+                    return error;
+                }
+                state = depth ? CJSON_GRAMMAR_COMMA_OR_END : CJSON_GRAMMAR_DONE;
+                continue;
+        }
+
+        // c closes the innermost container
+        depth--;
+        state = depth ? CJSON_GRAMMAR_COMMA_OR_END : CJSON_GRAMMAR_DONE;
+        i++;
+    }
+
+    if (state != CJSON_GRAMMAR_DONE) {
+        cjson_validate_fail(&error, JSON_ERROR_INCOMPLETE, len, "unexpected end of input");
+    }
+    return error;
+}
+
+// The tree builder as a SAX consumer: pass json_dom_handler with a
+// JsonDomBuilder as its context. Nodes come from arena when one is given.
+typedef struct {
+    JsonValue* container;
+    char* key; // object key still waiting for its value
+    CjsonKeyScratch seen;
+} CjsonDomFrame;
+
+typedef struct {
+    JsonValue* output;
+    JsonArena* arena;      // NULL when every node is malloc'd
+    CjsonDomFrame* stack;  // open containers, innermost last
+    bool complete;         // the root value has been closed
+    JsonKeyTable* keys;    // optional, set after init to intern object keys
+} JsonDomBuilder;
+
+void json_dom_builder_init(JsonDomBuilder* builder, JsonValue* output, JsonArena* arena){
+    builder->output = output;
+    builder->arena = arena;
+    builder->stack = NULL;
+    builder->complete = false;
+    builder->keys = NULL;
+    output->type = JSON_NULL;
+    output->flags = 0;
+    output->length = 0;
+}
+
+static char* cjson_dom_copy(JsonDomBuilder* builder, const char* str, size_t length){
+    char* copy = builder->arena ? json_arena_alloc_aligned(builder->arena, length + 1, 1) : malloc(length + 1);
+    memcpy(copy, str, length + 1);
+    return copy;
+}
+
+// Places a complete value: the root goes into output, everything else into
+// a fresh node hung off the innermost container. Returns where it landed.
+static JsonValue* cjson_dom_place(JsonDomBuilder* builder, const JsonValue* value){
+    if (arrlenu(builder->stack) == 0) {
+        *builder->output = *value;
+        builder->complete = value->type != JSON_OBJECT && value->type != JSON_ARRAY;
+        return builder->output;
+    }
+
+    JsonValue* node = cjson_alloc_node(builder->arena);
+    *node = *value;
+    CjsonDomFrame* top = &arrlast(builder->stack);
+    if (top->container->type == JSON_ARRAY) {
+        arrput(top->container->array, node);
+        return node;
+    }
+
+    if (builder->keys) node->flags |= JSON_FLAG_KEY_BORROWED;
+    if (!top->container->object) top->container->object = cjson_object_new(builder->arena);
+    JsonObject* object = top->container->object;
+    ptrdiff_t existing = cjson_key_scratch_find(&top->seen, object, top->key);
+    if (existing >= 0) {
+        // a repeated key keeps the last value
+        if (!builder->arena) {
+            json_free(object->pairs[existing].value);
+            if (!builder->keys) free(top->key);
+        }
+        object->pairs[existing].value = node;
+    } else {
+        cjson_object_append(object, top->key, node);
+    }
+    top->key = NULL;
+    return node;
+}
+
+static bool cjson_dom_open(JsonDomBuilder* builder, JsonType type){
+    JsonValue value;
+    value.type = type;
+    value.flags = 0;
+    value.length = 0;
+    if (type == JSON_OBJECT) value.object = NULL;
+    else value.array = NULL;
+
+    JsonValue* node = cjson_dom_place(builder, &value);
+    if (builder->arena) arrput(builder->arena->containers, node);
+    CjsonDomFrame frame = { .container = node, .key = NULL, .seen = { NULL, 0 } };
+    arrput(builder->stack, frame);
+    return true;
+}
+
+static bool cjson_dom_close(void* context){
+    JsonDomBuilder* builder = context;
+    CjsonDomFrame frame = arrpop(builder->stack);
+    free(frame.seen.slots);
+    builder->complete = arrlenu(builder->stack) == 0;
+    return true;
+}
+
+static bool cjson_dom_start_object(void* context){
+    return cjson_dom_open(context, JSON_OBJECT);
+}
+
+static bool cjson_dom_start_array(void* context){
+    return cjson_dom_open(context, JSON_ARRAY);
+}
+
+static bool cjson_dom_key(void* context, const char* key, size_t length){
+    JsonDomBuilder* builder = context;
+    if (builder->keys) {
+        arrlast(builder->stack).key = (char*)json_key_intern(builder->keys, key, length);
+    } else {
+        arrlast(builder->stack).key = cjson_dom_copy(builder, key, length);
+    }
+    return true;
+}
+
+static bool cjson_dom_string(void* context, const char* str, size_t length){
+    JsonDomBuilder* builder = context;
+    JsonValue value;
+    value.type = JSON_STRING;
+    value.flags = 0;
+    value.string = cjson_dom_copy(builder, str, length);
+    value.length = cjson_string_length_field(length);
+    cjson_dom_place(builder, &value);
+    return true;
+}
+
+static bool cjson_dom_number(void* context, const JsonValue* number){
+    cjson_dom_place(context, number);
+    return true;
+}
+
+static bool cjson_dom_boolean(void* context, bool boolean){
+    JsonValue value;
+    value.type = JSON_BOOL;
+    value.flags = 0;
+    value.length = 0;
+    value.boolean = boolean;
+    cjson_dom_place(context, &value);
+    return true;
+}
+
+static bool cjson_dom_null(void* context){
+    JsonValue value;
+    value.type = JSON_NULL;
+    value.flags = 0;
+    value.length = 0;
+    cjson_dom_place(context, &value);
+    return true;
+}
+
+static const JsonSaxHandler json_dom_handler = {
+    .start_object = cjson_dom_start_object,
+    .end_object = cjson_dom_close,
+    .start_array = cjson_dom_start_array,
+    .end_array = cjson_dom_close,
+    .key = cjson_dom_key,
+    .string = cjson_dom_string,
+    .number = cjson_dom_number,
+    .boolean = cjson_dom_boolean,
+    .null = cjson_dom_null,
+};
+
+// Releases the builder's own state. If the document never completed, the
+// partial tree in output is released too (unless it lives in an arena).
+void json_dom_builder_free(JsonDomBuilder* builder){
+    for (size_t i = 0; i < arrlenu(builder->stack); i++) {
+        if (!builder->arena && !builder->keys) free(builder->stack[i].key);
+        free(builder->stack[i].seen.slots);
+    }
+    if (!builder->arena && !builder->complete) {
+        cjson_free_contents(builder->output);
+    }
+    if (!builder->complete) {
+        builder->output->type = JSON_NULL;
+        builder->output->flags = 0;
+    }
+    arrfree(builder->stack);
+}
+
+// Push parsing: the document arrives in chunks of any size through
+// json_push_parser_feed and goes through the grammar as it comes in. Only a
+// token that straddles two chunks is copied aside; everything else is read
+// straight out of the chunk it arrived in, so the caller never holds the
+// whole body.
+typedef enum {
+    CJSON_LEX_IDLE,
+    CJSON_LEX_STRING,  // inside a string that began in an earlier chunk
+    CJSON_LEX_SCALAR,  // inside a number or keyword that began in an earlier chunk
+} CjsonLexState;
+
+// Keeps pointers into itself once initialized, so it must not be moved
+typedef struct {
+    CjsonGrammar grammar;
+    JsonDomBuilder builder; // used by json_push_parser_init only
+    bool builds_dom;
+    CjsonLexState lex;
+    bool lex_escape;        // the last chunk ended on the backslash of an escape
+    char* pending;          // bytes of the split token seen so far
+    size_t pending_offset;  // where the split token starts in the input
+    size_t offset;          // bytes fed before the current chunk
+} JsonPushParser;
+
+// Delivers events to handler instead of building a tree
+void json_push_parser_init_sax(JsonPushParser* parser, const JsonSaxHandler* handler, void* context){
+    cjson_grammar_init(&parser->grammar, handler, context);
+    parser->builds_dom = false;
+    parser->lex = CJSON_LEX_IDLE;
+    parser->lex_escape = false;
+    parser->pending = NULL;
+    parser->pending_offset = 0;
+    parser->offset = 0;
+}
+
+void json_push_parser_init(JsonPushParser* parser, JsonValue* output, JsonArena* arena){
+    json_dom_builder_init(&parser->builder, output, arena);
+    json_push_parser_init_sax(parser, &json_dom_handler, &parser->builder);
+    parser->builds_dom = true;
+}
+
+const JsonError* json_push_parser_error(const JsonPushParser* parser){
+    return &parser->grammar.error;
+}
+
+static inline bool cjson_is_structural(char c){
+    return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+// End of the number or keyword starting at index: the first delimiter, or length
+static size_t cjson_push_scan_scalar(const char* data, size_t index, size_t length){
+    while (index < length) {
+        char c = data[index];
+        if (cjson_is_whitespace[(uint8_t)c] || cjson_is_structural(c) || c == '"') break;
+        index++;
+    }
+    return index;
+}
+
+// Index of the closing quote of a string body starting at index, or length if
+// the chunk runs out first. *escape carries a split "\x" pair across chunks.
+static size_t cjson_push_scan_string(const char* data, size_t index, size_t length, bool* escape){
+    if (*escape) {
+        if (index >= length) return length;
+        index++;
+        *escape = false;
+    }
+    while (index < length) {
+        index = cjson_find_escape_char(data, index, length);
+        if (index >= length) break;
+        if (data[index] == '"') return index;
+        if (data[index] == '\\') {
+            if (index + 1 >= length) {
+                *escape = true;
+                return length;
+            }
+            index += 2;
+        } else {
+            index++; // raw control characters pass, as in the other parsers
+        }
+    }
+    return length;
+}
+
+// Holds on to the part of a split token that is in the current chunk
+static void cjson_push_keep(JsonPushParser* parser, const char* data, size_t length){
+    if (length) memcpy(arraddnptr(parser->pending, length), data, length);
+}
+
+static bool cjson_push_flush_pending(JsonPushParser* parser){
+    const char* text = parser->pending ? parser->pending : ""; // a split "" keeps nothing
+    bool ok;
+    if (parser->lex == CJSON_LEX_STRING) {
+        ok = cjson_grammar_string(&parser->grammar, text, arrlenu(parser->pending), parser->pending_offset);
+    } else {
+        ok = cjson_grammar_scalar(&parser->grammar, text, arrlenu(parser->pending), parser->pending_offset);
+    }
+    parser->lex = CJSON_LEX_IDLE;
+    if (parser->pending) arrdeln(parser->pending, 0, arrlenu(parser->pending));
+    return ok;
+}
+
+// Parses the next piece of the document. Returns false once the input is
+// known to be malformed; json_push_parser_error says why and where.
+bool json_push_parser_feed(JsonPushParser* parser, const char* data, size_t length){
+    CjsonGrammar* grammar = &parser->grammar;
+    if (grammar->error.code != JSON_OK) return false;
+
+    size_t i = 0;
+    if (parser->lex == CJSON_LEX_STRING) {
+        size_t end = cjson_push_scan_string(data, 0, length, &parser->lex_escape);
+        cjson_push_keep(parser, data, end);
+        if (end == length) {
+            parser->offset += length;
+            return true;
+        }
+        i = end + 1;
+        if (!cjson_push_flush_pending(parser)) return false;
+    } else if (parser->lex == CJSON_LEX_SCALAR) {
+        size_t end = cjson_push_scan_scalar(data, 0, length);
+        cjson_push_keep(parser, data, end);
+        if (end == length) {
+            parser->offset += length;
+            return true;
+        }
+        i = end;
+        if (!cjson_push_flush_pending(parser)) return false;
+    }
+
+    while (i < length) {
+        char c = data[i];
+        if (cjson_is_whitespace[(uint8_t)c]) {
+            i++;
+        } else if (cjson_is_structural(c)) {
+            if (!cjson_grammar_structural(grammar, c, parser->offset + i)) return false;
+            i++;
+        } else if (c == '"') {
+            size_t end = cjson_push_scan_string(data, i + 1, length, &parser->lex_escape);
+            if (end == length) {
+                parser->lex = CJSON_LEX_STRING;
+                parser->pending_offset = parser->offset + i;
+                cjson_push_keep(parser, data + i + 1, end - i - 1);
+                break;
+            }
+            if (!cjson_grammar_string(grammar, data + i + 1, end - i - 1, parser->offset + i)) return false;
+            i = end + 1;
+        } else {
+            size_t end = cjson_push_scan_scalar(data, i, length);
+            if (end == length) {
+                parser->lex = CJSON_LEX_SCALAR;
+                parser->pending_offset = parser->offset + i;
+                cjson_push_keep(parser, data + i, end - i);
+                break;
+            }
+            if (!cjson_grammar_scalar(grammar, data + i, end - i, parser->offset + i)) return false;
+            i = end;
+        }
+    }
+
+    parser->offset += length;
+    return true;
+}
+
+// Signals the end of input. Returns true when one complete document was seen.
+bool json_push_parser_end(JsonPushParser* parser){
+    CjsonGrammar* grammar = &parser->grammar;
+    if (grammar->error.code != JSON_OK) return false;
+
+    if (parser->lex == CJSON_LEX_STRING) {
+        return cjson_grammar_fail(grammar, JSON_ERROR_INCOMPLETE, parser->pending_offset, "unterminated string");
+    }
+    if (parser->lex == CJSON_LEX_SCALAR && !cjson_push_flush_pending(parser)) {
+        return false;
+    }
+    return cjson_grammar_end(grammar, parser->offset);
+}
+
+// Releases the parser's own buffers. A tree built by json_push_parser_init
+// is released too if the document never completed (unless it lives in an arena).
+void json_push_parser_free(JsonPushParser* parser){
+    if (parser->builds_dom) {
+        if (parser->grammar.error.code != JSON_OK) parser->builder.complete = false;
+        json_dom_builder_free(&parser->builder);
+    }
+    cjson_grammar_free(&parser->grammar);
+    arrfree(parser->pending);
+}
+
+// NDJSON / JSON Lines: one document per line. A raw newline can't occur
+// inside a valid JSON string, so memchr finds every record boundary.
+// Lines are parsed in batches by a pool of workers; the calling thread hands
+// the results to the callback strictly in input order. At most a few batches
+// per worker are held at once, whatever the input size.
+#ifndef CJSON_NDJSON_BATCH_SIZE
+    #define CJSON_NDJSON_BATCH_SIZE (256 * 1024)
+#endif
+
+// Called once per non-blank line, in input order, with its 0-based line
+// number. The callee owns record (release it with json_free). record is NULL
+// when the line is malformed; error then says why, with its offset counted
+// from the start of the whole buffer. Return false to stop early.
+typedef bool (*JsonRecordFn)(void* context, size_t line, JsonValue* record, const JsonError* error);
+
+typedef struct {
+    JsonValue* value;
+    size_t line;      // counted from the start of the batch
+    JsonError error;
+} CjsonNdjsonRecord;
+
+typedef struct {
+    CjsonNdjsonRecord* records;
+    size_t lines;
+    bool ready;
+} CjsonNdjsonBatch;
+
+typedef struct {
+    const char* data;
+    size_t length;
+    size_t next_start;        // first byte not yet claimed by a worker
+    size_t claimed;           // batches handed out so far
+    size_t delivered;         // batches passed to the callback so far
+    size_t window;            // batches that may be parsed ahead of delivery
+    CjsonNdjsonBatch* slots;  // batch n lives in slots[n % window]
+    bool stop;
+    JsonRecordFn callback;
+    void* context;
+    size_t line_base;         // first line number of the next batch to deliver
+#ifdef CJSON_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+#endif
+} CjsonNdjsonJob;
+
+static void cjson_ndjson_parse_batch(const char* data, size_t start, size_t end, CjsonNdjsonBatch* batch){
+    size_t line = 0;
+    while (start < end) {
+        const char* newline = memchr(data + start, '\n', end - start);
+        size_t stop = newline ? (size_t)(newline - data) : end;
+
+        size_t first = start;
+        while (first < stop && cjson_is_whitespace[(uint8_t)data[first]]) first++;
+        if (first < stop) {
+            CjsonNdjsonRecord record;
+            record.value = malloc(sizeof(JsonValue));
+            record.line = line;
+            JsonPushParser parser;
+            json_push_parser_init(&parser, record.value, NULL);
+            bool ok = json_push_parser_feed(&parser, data + start, stop - start) && json_push_parser_end(&parser);
+            record.error = *json_push_parser_error(&parser);
+            json_push_parser_free(&parser);
+            if (!ok) {
+                free(record.value);
+                record.value = NULL;
+                record.error.offset += start;
+            }
+            arrput(batch->records, record);
+        }
+
+        line++;
+        start = stop + 1;
+    }
+    batch->lines = line;
+}
+
+// Caller holds the lock. Cuts the next batch at the first newline past
+// CJSON_NDJSON_BATCH_SIZE bytes.
+static void cjson_ndjson_cut(CjsonNdjsonJob* job, size_t* start, size_t* end){
+    *start = job->next_start;
+    *end = job->length;
+    if (job->length - *start > CJSON_NDJSON_BATCH_SIZE) {
+        size_t target = *start + CJSON_NDJSON_BATCH_SIZE;
+        const char* newline = memchr(job->data + target, '\n', job->length - target);
+        if (newline) *end = (size_t)(newline - job->data) + 1;
+    }
+    job->next_start = *end;
+    job->claimed++;
+}
+
+// Runs the callback over one parsed batch and empties it. Returns false once
+// the callback asks to stop; records after that point are only released.
+static bool cjson_ndjson_deliver(CjsonNdjsonJob* job, CjsonNdjsonBatch* batch, bool proceed){
+    for (size_t i = 0; i < arrlenu(batch->records); i++) {
+        CjsonNdjsonRecord* record = &batch->records[i];
+        if (!proceed) {
+            json_free(record->value);
+            continue;
+        }
+        const JsonError* error = record->value ? NULL : &record->error;
+        proceed = job->callback(job->context, job->line_base + record->line, record->value, error);
+    }
+    job->line_base += batch->lines;
+    arrfree(batch->records);
+    batch->lines = 0;
+    batch->ready = false;
+    return proceed;
+}
+
+static void cjson_ndjson_run_serial(CjsonNdjsonJob* job){
+    CjsonNdjsonBatch batch = { .records = NULL, .lines = 0, .ready = false };
+    while (!job->stop && job->next_start < job->length) {
+        size_t start, end;
+        cjson_ndjson_cut(job, &start, &end);
+        cjson_ndjson_parse_batch(job->data, start, end, &batch);
+        job->stop = !cjson_ndjson_deliver(job, &batch, true);
+        job->delivered++;
+    }
+}
+
+#ifdef CJSON_THREADS
+static void* cjson_ndjson_worker(void* argument){
+    CjsonNdjsonJob* job = argument;
+    pthread_mutex_lock(&job->lock);
+    while (true) {
+        while (!job->stop && job->next_start < job->length && job->claimed >= job->delivered + job->window) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if (job->stop || job->next_start >= job->length) break;
+
+        size_t start, end;
+        size_t number = job->claimed;
+        cjson_ndjson_cut(job, &start, &end);
+        CjsonNdjsonBatch* batch = &job->slots[number % job->window];
+        pthread_mutex_unlock(&job->lock);
+
+        cjson_ndjson_parse_batch(job->data, start, end, batch);
+
+        pthread_mutex_lock(&job->lock);
+        batch->ready = true;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+static void cjson_ndjson_run_parallel(CjsonNdjsonJob* job, pthread_t* workers, size_t count){
+    pthread_mutex_lock(&job->lock);
+    while (!job->stop) {
+        CjsonNdjsonBatch* batch = &job->slots[job->delivered % job->window];
+        while (!batch->ready && !(job->next_start >= job->length && job->delivered == job->claimed)) {
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        if (!batch->ready) break; // everything delivered
+        pthread_mutex_unlock(&job->lock);
+
+        bool proceed = cjson_ndjson_deliver(job, batch, true);
+
+        pthread_mutex_lock(&job->lock);
+        job->stop = !proceed;
+        job->delivered++;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_cond_broadcast(&job->changed);
+    pthread_mutex_unlock(&job->lock);
+
+    for (size_t i = 0; i < count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    // batches finished after an early stop
+    for (size_t i = 0; i < job->window; i++) {
+        if (job->slots[i].ready) cjson_ndjson_deliver(job, &job->slots[i], false);
+    }
+}
+#endif
+
+// Parses every line of data with threads workers (0 = one per online CPU).
+// Returns false if the callback stopped the run early.
+bool json_ndjson_parse(const char* data, size_t length, size_t threads, JsonRecordFn callback, void* context){
+    CjsonNdjsonJob job;
+    job.data = data;
+    job.length = length;
+    job.next_start = 0;
+    job.claimed = 0;
+    job.delivered = 0;
+    job.window = 0;
+    job.slots = NULL;
+    job.stop = false;
+    job.callback = callback;
+    job.context = context;
+    job.line_base = 0;
+
+#ifdef CJSON_THREADS
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+    if (threads > 1 && length > CJSON_NDJSON_BATCH_SIZE) {
+        job.window = threads * 4;
+        job.slots = calloc(job.window, sizeof(CjsonNdjsonBatch));
+        pthread_t* workers = malloc(threads * sizeof(pthread_t));
+        pthread_mutex_init(&job.lock, NULL);
+        pthread_cond_init(&job.changed, NULL);
+
+        size_t started = 0;
+        while (started < threads && pthread_create(&workers[started], NULL, cjson_ndjson_worker, &job) == 0) {
+            started++;
+        }
+        if (started > 0) {
+            cjson_ndjson_run_parallel(&job, workers, started);
+        } else {
+            cjson_ndjson_run_serial(&job);
+        }
+
+        pthread_cond_destroy(&job.changed);
+        pthread_mutex_destroy(&job.lock);
+        free(workers);
+        free(job.slots);
+        return !job.stop;
+    }
+#else
+    (void)threads;
+#endif
+
+    cjson_ndjson_run_serial(&job);
+    return !job.stop;
+}
+
+bool json_ndjson_parse_file(const char* file_name, size_t threads, JsonRecordFn callback, void* context){
+    JsonMappedFile file;
+    if (!json_file_map(file_name, &file)) {
+        return false;
+    }
+    bool finished = json_ndjson_parse(file.data, file.length, threads, callback, context);
+    json_file_unmap(&file);
+    return finished;
+}
+
+typedef struct {
+    JsonValue** records;
+    JsonError* error;
+} CjsonNdjsonCollector;
+
+static bool cjson_ndjson_collect(void* context, size_t line, JsonValue* record, const JsonError* error){
+    CjsonNdjsonCollector* collector = context;
+    (void)line;
+    if (!record) {
+        if (collector->error) *collector->error = *error;
+        return false;
+    }
+    arrput(collector->records, record);
+    return true;
+}
+
+// Every record of data as an stb_ds array, each freed with json_free. On the
+// first malformed line returns NULL and fills error (which may be NULL).
+JsonValue** json_ndjson_load(const char* data, size_t length, size_t threads, JsonError* error){
+    CjsonNdjsonCollector collector = { .records = NULL, .error = error };
+    if (error) error->code = JSON_OK;
+    if (!json_ndjson_parse(data, length, threads, cjson_ndjson_collect, &collector)) {
+        for (size_t i = 0; i < arrlenu(collector.records); i++) {
+            json_free(collector.records[i]);
+        }
+        arrfree(collector.records);
+        return NULL;
+    }
+    return collector.records;
+}
+
+void json_init_object(JsonValue* json){
+    json->type = JSON_OBJECT;
+    json->flags = 0;
+    json->object = NULL;
+}
+
+void json_init_array(JsonValue* json){
+    json->type = JSON_ARRAY;
+    json->flags = 0;
+    json->array = NULL;
+}
+
+void json_add_child(JsonValue* json, const char* key, JsonValue* child) {
+    if (!child) {
+        fprintf(stderr, "Trying to add child that is NULL\n");
+        return;
+    }
+    if (json->type == JSON_OBJECT) {
+        if (key == NULL) {
+            fprintf(stderr, "Cannot put NULL key into object\n");
+            return;
+        }
+        ptrdiff_t existing = cjson_object_find(json->object, key);
+        if (existing >= 0) {
+            // the stored key stays, and with it the old value's key ownership
+            JsonValue* old = json->object->pairs[existing].value;
+            child->flags = (child->flags & ~JSON_FLAG_KEY_BORROWED) | (old->flags & JSON_FLAG_KEY_BORROWED);
+            json->object->pairs[existing].value = child;
+            return;
+        }
+        char* key_copy = malloc((strlen(key) + 1) * sizeof(char));
+        memcpy(key_copy, key, strlen(key) + 1);
+        child->flags &= ~JSON_FLAG_KEY_BORROWED;
+        if (!json->object) json->object = cjson_object_new(NULL);
+        cjson_object_append(json->object, key_copy, child);
+    } else if (json->type == JSON_ARRAY) {
+        if (key != NULL) {
+            fprintf(stderr, "Warn: Trying to add key to array\n");
+        }
+        arrput(json->array, child);
+    } else {
+        fprintf(stderr, "Cannot add child to non-object/array\n");
+    }
+}
+
+bool json_remove_key(JsonValue* json, const char* key){
+    if(json->type != JSON_OBJECT){
+        fprintf(stderr, "Cannot remove string key from non object json!\n");
+        return 1;
+    }
+    ptrdiff_t index = cjson_object_find(json->object, key);
+    if(index < 0) return 0;
+    JsonPair pair = json->object->pairs[index];
+    if(!(pair.value->flags & JSON_FLAG_KEY_BORROWED)) free(pair.key);
+    cjson_object_remove_at(json->object, (size_t)index);
+    return 1;
+}
+
+bool json_remove_child(JsonValue* json, JsonValue key){
+    if(key.type == JSON_STRING){
+        if(json->type != JSON_OBJECT){
+            fprintf(stderr, "Cannot remove string key from non object json!\n");
+            return 1;
+        }
+        return json_remove_key(json, key.string);
+    }else if(key.type == JSON_NUMBER){
+        if(json->type != JSON_ARRAY){
+            fprintf(stderr, "Cannot remove number key from non array json!\n");
+            return 1;
+        }
+        arrdel(json->array, (size_t)key.number);
+        return 0;
+    }
+    fprintf(stderr, "Cannot remove key from non array or object json!\n");
+    return 1;
+}
+
+
+bool json_remove_at(JsonValue* json, size_t index){
+    if(json->type != JSON_ARRAY){
+        fprintf(stderr, "Cannot remove number key from non array json!\n");
+        return 1;
+    }
+    arrdel(json->array, index);
+    return 0;
+}
+
+
+JsonValue* json_new_string(const char* str){
+    size_t len = strlen(str);
+    char* copy = malloc((len+1)*sizeof(char));
+
+    if(copy == NULL){
+        fprintf(stderr, "Could not duplicate string\n");
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    JsonValue* json_string = malloc(sizeof(JsonValue));
+    json_string->type = JSON_STRING;
+    json_string->flags = 0;
+    json_string->length = cjson_string_length_field(len);
+    json_string->string = copy;
+    return json_string;
+}
+
+// Copies n bytes, which may include NULs; the value keeps its explicit length
+JsonValue* json_new_nstring(const char* str, size_t n) {
+    char* copy = malloc((n+1)*sizeof(char));
 
     if (copy == NULL) {
         fprintf(stderr, "Could not allocate memory for string\n");
         return NULL;
     }
 
-    memcpy(copy, str, n);
-    copy[n] = '\0';
+    memcpy(copy, str, n);
+    copy[n] = '\0';
+
+    JsonValue* json_string = malloc(sizeof(JsonValue));
+    if (json_string == NULL) {
+        fprintf(stderr, "Could not allocate memory for JsonValue\n");
+        return NULL;
+    }
+
+    json_string->type = JSON_STRING;
+    json_string->flags = 0;
+    json_string->length = cjson_string_length_field(n);
+    json_string->string = copy;
+    return json_string;
+}
+
+JsonValue* json_new_number(double num){
+    JsonValue* json_num = malloc(sizeof(JsonValue));
+    json_num->type = JSON_NUMBER;
+    json_num->flags = 0;
+    json_num->number = num;
+    return json_num;
+}
+
+// Integers beyond 2^53 are stored exactly, like parsed ones
+JsonValue* json_new_int64(int64_t num){
+    JsonValue* json_num = malloc(sizeof(JsonValue));
+    json_num->type = JSON_NUMBER;
+    json_num->flags = 0;
+    if(num > (int64_t)CJSON_MAX_EXACT_DOUBLE_INT || num < -(int64_t)CJSON_MAX_EXACT_DOUBLE_INT){
+        json_num->flags = JSON_FLAG_INT64;
+        json_num->integer = num;
+    }
+    json_num->number = (double)num;
+    return json_num;
+}
+
+JsonValue* json_new_uint64(uint64_t num){
+    if(num <= (uint64_t)INT64_MAX){
+        return json_new_int64((int64_t)num);
+    }
+    JsonValue* json_num = malloc(sizeof(JsonValue));
+    json_num->type = JSON_NUMBER;
+    json_num->flags = JSON_FLAG_UINT64;
+    json_num->uinteger = num;
+    json_num->number = (double)num;
+    return json_num;
+}
+
+// Value of any JSON_NUMBER as a double, exact 64-bit integers rounded
+double json_get_number(const JsonValue* json){
+    return json->number;
+}
+
+// True when the number is an integer that fits in int64_t
+bool json_get_int64(const JsonValue* json, int64_t* out){
+    if(json->type != JSON_NUMBER || (json->flags & JSON_FLAG_UINT64)) return false;
+    if(json->flags & JSON_FLAG_INT64){
+        *out = json->integer;
+        return true;
+    }
+    double num = json->number;
+    if(!(num >= -9223372036854775808.0 && num < 9223372036854775808.0)) return false;
+    if((double)(int64_t)num != num) return false;
+    *out = (int64_t)num;
+    return true;
+}
+
+// True when the number is an integer that fits in uint64_t
+bool json_get_uint64(const JsonValue* json, uint64_t* out){
+    if(json->type != JSON_NUMBER) return false;
+    if(json->flags & JSON_FLAG_UINT64){
+        *out = json->uinteger;
+        return true;
+    }
+    if(json->flags & JSON_FLAG_INT64){
+        if(json->integer < 0) return false;
+        *out = (uint64_t)json->integer;
+        return true;
+    }
+    double num = json->number;
+    if(!(num >= 0 && num < 18446744073709551616.0)) return false;
+    if((double)(uint64_t)num != num) return false;
+    *out = (uint64_t)num;
+    return true;
+}
+
+// Member of an object by key; NULL when json is NULL, not an object or lacks the key.
+// NULL in gives NULL out, so lookups chain: json_get_child(json_get_child(doc, "a"), "b")
+JsonValue* json_get_child(JsonValue* json, const char* key){
+    if(!json || json->type != JSON_OBJECT) return NULL;
+    ptrdiff_t index = cjson_object_find(json->object, key);
+    return index >= 0 ? json->object->pairs[index].value : NULL;
+}
+
+// Element of an array; NULL when json is NULL, not an array or index is out of range
+JsonValue* json_get_at(JsonValue* json, size_t index){
+    if(!json || json->type != JSON_ARRAY || index >= arrlenu(json->array)) return NULL;
+    return json->array[index];
+}
+
+// Member of an object by position in insertion order; NULL when json is NULL,
+// not an object or index is out of range
+JsonPair* json_get_member(JsonValue* json, size_t index){
+    if(!json || json->type != JSON_OBJECT || index >= cjson_object_count(json->object)) return NULL;
+    return &json->object->pairs[index];
+}
+
+// Elements of an array, members of an object or bytes of a string; 0 otherwise
+size_t json_length(const JsonValue* json){
+    if(!json) return 0;
+    switch(json->type){
+        case JSON_ARRAY: return arrlenu(json->array);
+        case JSON_OBJECT: return cjson_object_count(json->object);
+        case JSON_STRING: return json_string_length(json);
+        default: return 0;
+    }
+}
+
+// Bytes json and everything under it occupy: nodes, owned strings and keys,
+// and container storage at its current capacity. Borrowed strings and keys
+// live in someone else's buffer and are left out; interned keys are shared
+// across the document and count once per member. Arena documents report
+// what their nodes use, not the arena's block slack.
+size_t json_memory_usage(const JsonValue* json){
+    if(!json) return 0;
+    size_t total = sizeof(JsonValue);
+    switch(json->type){
+        case JSON_STRING:
+            if(!(json->flags & JSON_FLAG_BORROWED)) total += json_string_length(json) + 1;
+            break;
+        case JSON_ARRAY:
+            if(json->array){
+                total += sizeof(stbds_array_header) + arrcap(json->array) * sizeof(JsonValue*);
+                for(size_t i = 0; i < arrlenu(json->array); i++){
+                    total += json_memory_usage(json->array[i]);
+                }
+            }
+            break;
+        case JSON_OBJECT:
+            if(json->object){
+                const JsonObject* object = json->object;
+                total += sizeof(JsonObject) + object->capacity * sizeof(uint32_t);
+                total += sizeof(stbds_array_header) + arrcap(object->pairs) * sizeof(JsonPair);
+                for(size_t i = 0; i < arrlenu(object->pairs); i++){
+                    const JsonPair* pair = &object->pairs[i];
+                    if(!(pair->value->flags & JSON_FLAG_KEY_BORROWED)) total += strlen(pair->key) + 1;
+                    total += json_memory_usage(pair->value);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    return total;
+}
+
+// On-demand access: a JsonLazy is a cursor to the first byte of a value in
+// the raw document. Nothing is decoded until it is asked for, and subtrees
+// that are stepped over are skipped by bracket matching, never built. With
+// a stage 1 index each step is an index lookup; without one the bytes are
+// scanned. The calls mirror json_get_child/json_get_at/json_length and a
+// missing value flows through them like NULL does, so lookups chain.
+// Only what is visited is validated.
+typedef struct {
+    char* json;                  // NUL-terminated, outlives the document
+    size_t length;
+    uint32_t* structurals;       // optional stage 1 index of token starts
+} JsonLazyDoc;
+
+typedef struct {
+    const JsonLazyDoc* doc;      // NULL for a missing value
+    size_t offset;               // first byte of the value
+    size_t token;                // its position in doc->structurals
+} JsonLazy;
+
+static const JsonLazy cjson_lazy_missing = { NULL, 0, 0 };
+
+// indexed runs stage 1 up front; it pays off when the document is walked many times
+void json_lazy_open(JsonLazyDoc* doc, char* json, size_t length, bool indexed){
+    doc->json = json;
+    doc->length = length;
+    doc->structurals = indexed ? cjson_index_structurals(json, length) : NULL;
+}
+
+void json_lazy_close(JsonLazyDoc* doc){
+    arrfree(doc->structurals);
+}
+
+static size_t cjson_skip_whitespace(const char* json, size_t offset){
+    while (cjson_is_whitespace[(uint8_t)json[offset]]) offset++;
+    return offset;
+}
+
+// Offset of the closing quote of the string opening at offset (or of the NUL if unterminated)
+static size_t cjson_lazy_string_end(const char* json, size_t offset){
+    size_t index = offset + 1;
+    while (true) {
+        index = cjson_scan_string(json, index);
+        if (json[index] == '\\' && json[index + 1] != '\0') {
+            index += 2;
+        } else {
+            return index;
+        }
+    }
+}
+
+static size_t cjson_lazy_scalar_end(const char* json, size_t offset){
+    while (json[offset] != '\0' && !cjson_is_whitespace[(uint8_t)json[offset]] &&
+           !cjson_is_structural(json[offset]) && json[offset] != '"') {
+        offset++;
+    }
+    return offset;
+}
+
+JsonLazy json_lazy_root(const JsonLazyDoc* doc){
+    JsonLazy root = { doc, 0, 0 };
+    root.offset = doc->structurals ? doc->structurals[0] : cjson_skip_whitespace(doc->json, 0);
+    return root;
+}
+
+bool json_lazy_exists(JsonLazy value){
+    return value.doc != NULL;
+}
+
+// Moves to the next token
+static void cjson_lazy_step(JsonLazy* at){
+    const JsonLazyDoc* doc = at->doc;
+    if (doc->structurals) {
+        if (at->offset < doc->length) at->offset = doc->structurals[++at->token];
+        return;
+    }
+    const char* json = doc->json;
+    size_t end;
+    if (json[at->offset] == '"') {
+        end = cjson_lazy_string_end(json, at->offset);
+        if (json[end] == '"') end++;
+    } else if (cjson_is_structural(json[at->offset])) {
+        end = at->offset + 1;
+    } else if (json[at->offset] == '\0') {
+        return;
+    } else {
+        end = cjson_lazy_scalar_end(json, at->offset);
+    }
+    at->offset = cjson_skip_whitespace(json, end);
+}
+
+// Moves past the value at the cursor, matching brackets for containers
+static void cjson_lazy_skip(JsonLazy* at){
+    const char* json = at->doc->json;
+    size_t depth = 0;
+    do {
+        char c = json[at->offset];
+        if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') depth--;
+        else if (c == '\0') return;
+        cjson_lazy_step(at);
+    } while (depth > 0);
+}
+
+JsonType json_lazy_type(JsonLazy value){
+    if (!value.doc) return JSON_NULL;
+    switch (value.doc->json[value.offset]) {
+        case '{': return JSON_OBJECT;
+        case '[': return JSON_ARRAY;
+        case '"': return JSON_STRING;
+        case 't':
+        case 'f': return JSON_BOOL;
+        case 'n': return JSON_NULL;
+        default:  return JSON_NUMBER;
+    }
+}
+
+// First element of an array or first key of an object; missing when empty.
+// On a key, json_lazy_member_value gives the value.
+JsonLazy json_lazy_first(JsonLazy container){
+    if (!container.doc) return container;
+    char open = container.doc->json[container.offset];
+    if (open != '{' && open != '[') return cjson_lazy_missing;
+    cjson_lazy_step(&container);
+    char c = container.doc->json[container.offset];
+    if (c == ']' || c == '}' || c == '\0') return cjson_lazy_missing;
+    return container;
+}
+
+// Sibling after an element (or after a key and its value); missing at the end
+JsonLazy json_lazy_next(JsonLazy element){
+    if (!element.doc) return element;
+    const char* json = element.doc->json;
+    cjson_lazy_skip(&element);
+    if (json[element.offset] == ':') {
+        cjson_lazy_step(&element);
+        cjson_lazy_skip(&element);
+    }
+    if (json[element.offset] != ',') return cjson_lazy_missing;
+    cjson_lazy_step(&element);
+    return element;
+}
+
+// Value belonging to the key at the cursor
+JsonLazy json_lazy_member_value(JsonLazy key){
+    if (!key.doc || key.doc->json[key.offset] != '"') return cjson_lazy_missing;
+    cjson_lazy_step(&key);
+    if (key.doc->json[key.offset] != ':') return cjson_lazy_missing;
+    cjson_lazy_step(&key);
+    return key;
+}
+
+// Compares the string at the cursor with text after decoding its escapes
+bool json_lazy_string_equals(JsonLazy value, const char* text, size_t length){
+    if (!value.doc || value.doc->json[value.offset] != '"') return false;
+    const char* body = value.doc->json + value.offset + 1;
+    size_t end = cjson_lazy_string_end(value.doc->json, value.offset);
+    size_t body_length = end - value.offset - 1;
+
+    if (!memchr(body, '\\', body_length)) {
+        return body_length == length && memcmp(body, text, length) == 0;
+    }
+    if (body_length < length) return false; // escapes only ever shrink
+    char* decoded = malloc(body_length + 1);
+    size_t decoded_length;
+    bool equal = cjson_unescape(body, body_length, decoded, &decoded_length) &&
+                 decoded_length == length && memcmp(decoded, text, length) == 0;
+    free(decoded);
+    return equal;
+}
+
+// Member of an object by key (the first one if the key repeats)
+JsonLazy json_lazy_get_child(JsonLazy object, const char* key){
+    if (json_lazy_type(object) != JSON_OBJECT) return cjson_lazy_missing;
+    size_t key_length = strlen(key);
+    for (JsonLazy member = json_lazy_first(object); member.doc; member = json_lazy_next(member)) {
+        if (json_lazy_string_equals(member, key, key_length)) {
+            return json_lazy_member_value(member);
+        }
+    }
+    return cjson_lazy_missing;
+}
+
+JsonLazy json_lazy_get_at(JsonLazy array, size_t index){
+    if (json_lazy_type(array) != JSON_ARRAY) return cjson_lazy_missing;
+    JsonLazy element = json_lazy_first(array);
+    while (element.doc && index--) {
+        element = json_lazy_next(element);
+    }
+    return element;
+}
+
+// Elements of an array or members of an object, counted by skipping; 0 otherwise
+size_t json_lazy_length(JsonLazy container){
+    JsonType type = json_lazy_type(container);
+    if (!container.doc || (type != JSON_ARRAY && type != JSON_OBJECT)) return 0;
+    size_t count = 0;
+    for (JsonLazy element = json_lazy_first(container); element.doc; element = json_lazy_next(element)) {
+        count++;
+    }
+    return count;
+}
+
+// Decodes a number the same way the DOM parsers do. False if value is not a valid number.
+bool json_lazy_get_value(JsonLazy value, JsonValue* out){
+    if (json_lazy_type(value) != JSON_NUMBER) return false;
+    const char* start = value.doc->json + value.offset;
+    size_t length = cjson_lazy_scalar_end(value.doc->json, value.offset) - value.offset;
+    if (!cjson_number_is_valid(start, length)) return false;
+    cjson_number_from_token(start, length, out);
+    out->length = 0;
+    return true;
+}
+
+double json_lazy_get_number(JsonLazy value){
+    JsonValue number;
+    return json_lazy_get_value(value, &number) ? json_get_number(&number) : 0;
+}
+
+bool json_lazy_get_int64(JsonLazy value, int64_t* out){
+    JsonValue number;
+    return json_lazy_get_value(value, &number) && json_get_int64(&number, out);
+}
+
+bool json_lazy_get_bool(JsonLazy value){
+    return value.doc && value.doc->json[value.offset] == 't';
+}
+
+// Decoded copy of a string value, release it with free. NULL if value is not a string.
+char* json_lazy_get_string(JsonLazy value, size_t* length){
+    if (json_lazy_type(value) != JSON_STRING) return NULL;
+    const char* body = value.doc->json + value.offset + 1;
+    size_t body_length = cjson_lazy_string_end(value.doc->json, value.offset) - value.offset - 1;
+    char* copy = malloc(body_length + 1);
+    size_t decoded;
+    if (!cjson_unescape(body, body_length, copy, &decoded)) {
+        free(copy);
+        return NULL;
+    }
+    if (length) *length = decoded;
+    return copy;
+}
+
+// Builds the subtree at the cursor as a regular tree, release it with json_free.
+// Only the bytes of that value go through the checking push parser, so a
+// malformed subtree gives NULL like any other missing value.
+JsonValue* json_lazy_materialize(JsonLazy value){
+    if (!value.doc) return NULL;
+    JsonLazy end = value;
+    cjson_lazy_skip(&end);
+
+    JsonValue* output = malloc(sizeof(JsonValue));
+    JsonPushParser parser;
+    json_push_parser_init(&parser, output, NULL);
+    bool ok = json_push_parser_feed(&parser, value.doc->json + value.offset, end.offset - value.offset) &&
+              json_push_parser_end(&parser);
+    json_push_parser_free(&parser);
+    if (!ok) {
+        free(output);
+        return NULL;
+    }
+    return output;
+}
+
+
+JsonValue* json_new_bool(bool value){
+    JsonValue* json_bool = malloc(sizeof(JsonValue));
+    json_bool->type = JSON_BOOL;
+    json_bool->flags = 0;
+    json_bool->boolean = value;
+    return json_bool;
+}
+
+JsonValue* json_new_null(){
+    JsonValue* json_null = malloc(sizeof(JsonValue));
+    json_null->type = JSON_NULL;
+    json_null->flags = 0;
+    return json_null;
+}
+
+#define STR_ARR(...) (const char*[]){__VA_ARGS__}, \
+                     sizeof((const char*[]){__VA_ARGS__}) / sizeof(const char*)
+
+#define NUM_ARR(...) (double[]){__VA_ARGS__}, \
+                     sizeof((double[]){__VA_ARGS__}) / sizeof(double)
+
+
+
+
+JsonValue* json_new_sarray(const char** items, size_t length){
+    JsonValue* json_array = malloc(sizeof(JsonValue));
+    json_array->type = JSON_ARRAY;
+    json_array->flags = 0;
+    json_array->array = NULL;
+    for(size_t i = 0; i < length; i++){
+        const char* item = items[i];
+        JsonValue* json_string = json_new_string(item);
+        json_add_child(json_array, NULL, json_string);
+    }
+    return json_array;
+}
+
+JsonValue* json_new_narray(const double* items, size_t length){
+    JsonValue* json_array = malloc(sizeof(JsonValue));
+    json_array->type = JSON_ARRAY;
+    json_array->flags = 0;
+    json_array->array = NULL;
+    for(size_t i = 0; i < length; i++){
+        double item = items[i];
+        JsonValue* json_number = json_new_number(item);
+        json_add_child(json_array, NULL, json_number);
+    }
+    return json_array;
+}
+
+JsonValue* json_new_object(){
+    JsonValue* json_object = malloc(sizeof(JsonValue));
+    json_object->type = JSON_OBJECT;
+    json_object->flags = 0;
+    json_object->object = NULL;
+    return json_object;
+}
+
+JsonValue* json_new_array(){
+    JsonValue* json_array = malloc(sizeof(JsonValue));
+    json_array->type = JSON_ARRAY;
+    json_array->flags = 0;
+    json_array->array = NULL;
+    return json_array;
+}
+
+// Tape DOM: an immutable document flattened into one array of tagged 64-bit
+// words, walked front to back with no pointers to chase. The top byte of a
+// word is its tag, the low 56 bits its payload:
+//   '{' '['   low 32 bits: index just past the matching end word,
+//             bits 32-55: member/element count (saturated at 0xFFFFFF)
+//   '}' ']'   index of the matching start word
+//   'k' '"'   key / string: offset of its entry in the string buffer
+//   'd' 'l' 'u'  double / int64 / uint64; the raw value is the next word
+//   't' 'f' 'n'  true / false / null
+// String entries are a uint32_t byte length, the bytes and a NUL. Everything
+// is an offset, so a tape can be copied or written out as is; see
+// json_tape_save for reopening one straight from disk. Word indices and
+// string lengths have 32 bits, so building a tape fails with
+// JSON_ERROR_TOO_LARGE once either passes CJSON_TAPE_MAX_INDEX.
+typedef enum {
+    JSON_TAPE_OBJECT = '{', JSON_TAPE_OBJECT_END = '}',
+    JSON_TAPE_ARRAY = '[', JSON_TAPE_ARRAY_END = ']',
+    JSON_TAPE_KEY = 'k', JSON_TAPE_STRING = '"',
+    JSON_TAPE_DOUBLE = 'd', JSON_TAPE_INT64 = 'l', JSON_TAPE_UINT64 = 'u',
+    JSON_TAPE_TRUE = 't', JSON_TAPE_FALSE = 'f', JSON_TAPE_NULL = 'n',
+} JsonTapeTag;
+
+#define CJSON_TAPE_WORD(tag, payload) (((uint64_t)(tag) << 56) | (uint64_t)(payload))
+#define CJSON_TAPE_TAG(word) ((uint8_t)((word) >> 56))
+#define CJSON_TAPE_PAYLOAD(word) ((word) & 0x00FFFFFFFFFFFFFFULL)
+#define CJSON_TAPE_MAX_COUNT 0xFFFFFF
+#define CJSON_TAPE_MAX_INDEX UINT32_MAX
+
+typedef struct {
+    uint64_t* words;  // stb_ds array, or inside the snapshot of an opened tape
+    char* strings;    // string entries, the same way
+    size_t count;     // words on the tape
+    void* snapshot;   // the file an opened tape reads from, NULL for a built one
+    size_t snapshot_length; // bytes mapped, 0 when the file was read into memory
+} JsonTape;
+
+// A value on a tape; tape is NULL for a missing value
+typedef struct {
+    const JsonTape* tape;
+    size_t index;
+} JsonTapeRef;
+
+static const JsonTapeRef cjson_tape_missing = { NULL, 0 };
+
+typedef struct {
+    size_t start;    // index of the '{' or '[' word
+    uint32_t count;
+    bool object;
+} CjsonTapeOpen;
+
+typedef struct {
+    JsonTape* tape;
+    CjsonTapeOpen* open;
+    JsonError error; // JSON_ERROR_TOO_LARGE once the tape outgrows its 32-bit fields
+} CjsonTapeBuilder;
+
+static bool cjson_tape_too_large(CjsonTapeBuilder* builder, const char* message){
+    builder->error.code = JSON_ERROR_TOO_LARGE;
+    builder->error.offset = 0;
+    builder->error.message = message;
+    return false;
+}
+
+static void cjson_tape_count(CjsonTapeBuilder* builder, bool key){
+    if (arrlenu(builder->open) == 0) return;
+    CjsonTapeOpen* top = &arrlast(builder->open);
+    if (top->object == key && top->count < CJSON_TAPE_MAX_COUNT) top->count++;
+}
+
+static bool cjson_tape_string_entry(CjsonTapeBuilder* builder, const char* str, size_t length, uint64_t* offset){
+    if (length > CJSON_TAPE_MAX_INDEX) return cjson_tape_too_large(builder, "string too long for a tape");
+    JsonTape* tape = builder->tape;
+    *offset = arrlenu(tape->strings);
+    uint32_t stored = (uint32_t)length;
+    memcpy(arraddnptr(tape->strings, sizeof(stored)), &stored, sizeof(stored));
+    if (length) memcpy(arraddnptr(tape->strings, length), str, length);
+    arrput(tape->strings, '\0');
+    return true;
+}
+
+static bool cjson_tape_open(CjsonTapeBuilder* builder, bool object){
+    if (arrlenu(builder->tape->words) >= CJSON_TAPE_MAX_INDEX) return cjson_tape_too_large(builder, "document too large for a tape");
+    cjson_tape_count(builder, false);
+    CjsonTapeOpen entry = { .start = arrlenu(builder->tape->words), .count = 0, .object = object };
+    arrput(builder->open, entry);
+    arrput(builder->tape->words, CJSON_TAPE_WORD(object ? JSON_TAPE_OBJECT : JSON_TAPE_ARRAY, 0));
+    return true;
+}
+
+static bool cjson_tape_close(CjsonTapeBuilder* builder){
+    uint64_t end = arrlenu(builder->tape->words);
+    // the start word keeps end + 1 in 32 bits
+    if (end >= CJSON_TAPE_MAX_INDEX) return cjson_tape_too_large(builder, "document too large for a tape");
+    CjsonTapeOpen entry = arrpop(builder->open);
+    arrput(builder->tape->words, CJSON_TAPE_WORD(entry.object ? JSON_TAPE_OBJECT_END : JSON_TAPE_ARRAY_END, entry.start));
+    builder->tape->words[entry.start] = CJSON_TAPE_WORD(entry.object ? JSON_TAPE_OBJECT : JSON_TAPE_ARRAY,
+                                                       ((uint64_t)entry.count << 32) | (end + 1));
+    return true;
+}
+
+static bool cjson_tape_start_object(void* context){
+    return cjson_tape_open(context, true);
+}
+
+static bool cjson_tape_start_array(void* context){
+    return cjson_tape_open(context, false);
+}
+
+static bool cjson_tape_end(void* context){
+    return cjson_tape_close(context);
+}
+
+static bool cjson_tape_key(void* context, const char* key, size_t length){
+    CjsonTapeBuilder* builder = context;
+    cjson_tape_count(builder, true);
+    uint64_t offset;
+    if (!cjson_tape_string_entry(builder, key, length, &offset)) return false;
+    arrput(builder->tape->words, CJSON_TAPE_WORD(JSON_TAPE_KEY, offset));
+    return true;
+}
+
+static bool cjson_tape_string(void* context, const char* str, size_t length){
+    CjsonTapeBuilder* builder = context;
+    cjson_tape_count(builder, false);
+    uint64_t offset;
+    if (!cjson_tape_string_entry(builder, str, length, &offset)) return false;
+    arrput(builder->tape->words, CJSON_TAPE_WORD(JSON_TAPE_STRING, offset));
+    return true;
+}
+
+static bool cjson_tape_number(void* context, const JsonValue* number){
+    CjsonTapeBuilder* builder = context;
+    cjson_tape_count(builder, false);
+    uint64_t raw;
+    if (number->flags & JSON_FLAG_INT64) {
+        arrput(builder->tape->words, CJSON_TAPE_WORD(JSON_TAPE_INT64, 0));
+        raw = (uint64_t)number->integer;
+    } else if (number->flags & JSON_FLAG_UINT64) {
+        arrput(builder->tape->words, CJSON_TAPE_WORD(JSON_TAPE_UINT64, 0));
+        raw = number->uinteger;
+    } else {
+        arrput(builder->tape->words, CJSON_TAPE_WORD(JSON_TAPE_DOUBLE, 0));
+        memcpy(&raw, &number->number, sizeof(raw));
+    }
+    arrput(builder->tape->words, raw);
+    return true;
+}
+
+static bool cjson_tape_boolean(void* context, bool value){
+    CjsonTapeBuilder* builder = context;
+    cjson_tape_count(builder, false);
+    arrput(builder->tape->words, CJSON_TAPE_WORD(value ? JSON_TAPE_TRUE : JSON_TAPE_FALSE, 0));
+    return true;
+}
+
+static bool cjson_tape_null(void* context){
+    CjsonTapeBuilder* builder = context;
+    cjson_tape_count(builder, false);
+    arrput(builder->tape->words, CJSON_TAPE_WORD(JSON_TAPE_NULL, 0));
+    return true;
+}
+
+static const JsonSaxHandler cjson_tape_handler = {
+    .start_object = cjson_tape_start_object,
+    .end_object = cjson_tape_end,
+    .start_array = cjson_tape_start_array,
+    .end_array = cjson_tape_end,
+    .key = cjson_tape_key,
+    .string = cjson_tape_string,
+    .number = cjson_tape_number,
+    .boolean = cjson_tape_boolean,
+    .null = cjson_tape_null,
+};
+
+void json_tape_free(JsonTape* tape){
+    if (!tape->snapshot) {
+        arrfree(tape->words);
+        arrfree(tape->strings);
+    } else {
+#ifdef CJSON_POSIX
+        if (tape->snapshot_length) munmap(tape->snapshot, tape->snapshot_length);
+        else
+#endif
+        {
+            char* content = tape->snapshot;
+            arrfree(content);
+        }
+    }
+    tape->words = NULL;
+    tape->strings = NULL;
+    tape->count = 0;
+    tape->snapshot = NULL;
+    tape->snapshot_length = 0;
+}
+
+static void cjson_tape_init(JsonTape* tape){
+    tape->words = NULL;
+    tape->strings = NULL;
+    tape->count = 0;
+    tape->snapshot = NULL;
+    tape->snapshot_length = 0;
+}
+
+// Parses json straight onto a tape; no JsonValue tree is built. On failure
+// the tape is left empty and error (may be NULL) says why.
+bool json_tape_parse(char* json, JsonTape* tape, JsonError* error){
+    cjson_tape_init(tape);
+    CjsonTapeBuilder builder = { .tape = tape, .open = NULL, .error = { JSON_OK, 0, NULL } };
+    bool ok = json_sax_parse(json, &cjson_tape_handler, &builder, error);
+    if (!ok && builder.error.code != JSON_OK && error) {
+        // the handler stopped the parse; keep where, report why
+        error->code = builder.error.code;
+        error->message = builder.error.message;
+    }
+    arrfree(builder.open);
+    if (!ok) json_tape_free(tape);
+    tape->count = arrlenu(tape->words);
+    return ok;
+}
+
+static bool cjson_tape_append_value(CjsonTapeBuilder* builder, const JsonValue* json){
+    switch (json->type) {
+        case JSON_OBJECT:
+            if (!cjson_tape_open(builder, true)) return false;
+            for (size_t i = 0; i < cjson_object_count(json->object); i++) {
+                const JsonPair* pair = &json->object->pairs[i];
+                if (!cjson_tape_key(builder, pair->key, strlen(pair->key)) ||
+                    !cjson_tape_append_value(builder, pair->value)) return false;
+            }
+            return cjson_tape_close(builder);
+        case JSON_ARRAY:
+            if (!cjson_tape_open(builder, false)) return false;
+            for (size_t i = 0; i < arrlenu(json->array); i++) {
+                if (!cjson_tape_append_value(builder, json->array[i])) return false;
+            }
+            return cjson_tape_close(builder);
+        case JSON_STRING:
+            return cjson_tape_string(builder, json->string, json_string_length(json));
+        case JSON_NUMBER:
+            return cjson_tape_number(builder, json);
+        case JSON_BOOL:
+            return cjson_tape_boolean(builder, json->boolean);
+        case JSON_NULL:
+            return cjson_tape_null(builder);
+    }
+    return true;
+}
+
+// Flattens a tree onto a new tape; the tree is left as it is. On failure
+// the tape is left empty and error (may be NULL) says why.
+bool json_tape_from_value(const JsonValue* json, JsonTape* tape, JsonError* error){
+    cjson_tape_init(tape);
+    CjsonTapeBuilder builder = { .tape = tape, .open = NULL, .error = { JSON_OK, 0, NULL } };
+    bool ok = cjson_tape_append_value(&builder, json);
+    arrfree(builder.open);
+    if (!ok) json_tape_free(tape);
+    if (error) *error = builder.error;
+    tape->count = arrlenu(tape->words);
+    return ok;
+}
+
+JsonTapeRef json_tape_root(const JsonTape* tape){
+    JsonTapeRef root = { tape->count ? tape : NULL, 0 };
+    return root;
+}
+
+bool json_tape_exists(JsonTapeRef ref){
+    return ref.tape != NULL;
+}
+
+static inline uint64_t cjson_tape_word(JsonTapeRef ref){
+    return ref.tape->words[ref.index];
+}
+
+// Index of the next value after the one at index, in O(1)
+static size_t cjson_tape_after(const JsonTape* tape, size_t index){
+    uint64_t word = tape->words[index];
+    switch (CJSON_TAPE_TAG(word)) {
+        case JSON_TAPE_OBJECT:
+        case JSON_TAPE_ARRAY:
+            return (size_t)(word & 0xFFFFFFFFu);
+        case JSON_TAPE_DOUBLE:
+        case JSON_TAPE_INT64:
+        case JSON_TAPE_UINT64:
+            return index + 2;
+        default:
+            return index + 1;
+    }
+}
+
+JsonType json_tape_type(JsonTapeRef ref){
+    if (!ref.tape) return JSON_NULL;
+    switch (CJSON_TAPE_TAG(cjson_tape_word(ref))) {
+        case JSON_TAPE_OBJECT: return JSON_OBJECT;
+        case JSON_TAPE_ARRAY: return JSON_ARRAY;
+        case JSON_TAPE_KEY:
+        case JSON_TAPE_STRING: return JSON_STRING;
+        case JSON_TAPE_DOUBLE:
+        case JSON_TAPE_INT64:
+        case JSON_TAPE_UINT64: return JSON_NUMBER;
+        case JSON_TAPE_TRUE:
+        case JSON_TAPE_FALSE: return JSON_BOOL;
+        default: return JSON_NULL;
+    }
+}
+
+// First element of an array or first key of an object; missing when empty.
+// On a key, json_tape_member_value gives the value.
+JsonTapeRef json_tape_first(JsonTapeRef container){
+    JsonType type = json_tape_type(container);
+    if (!container.tape || (type != JSON_OBJECT && type != JSON_ARRAY)) return cjson_tape_missing;
+    container.index++;
+    uint8_t tag = CJSON_TAPE_TAG(cjson_tape_word(container));
+    if (tag == JSON_TAPE_OBJECT_END || tag == JSON_TAPE_ARRAY_END) return cjson_tape_missing;
+    return container;
+}
+
+// Sibling after an element (or after a key and its value); missing at the end
+JsonTapeRef json_tape_next(JsonTapeRef element){
+    if (!element.tape) return element;
+    bool key = CJSON_TAPE_TAG(cjson_tape_word(element)) == JSON_TAPE_KEY;
+    element.index = cjson_tape_after(element.tape, element.index);
+    if (key) element.index = cjson_tape_after(element.tape, element.index);
+    uint8_t tag = CJSON_TAPE_TAG(cjson_tape_word(element));
+    if (tag == JSON_TAPE_OBJECT_END || tag == JSON_TAPE_ARRAY_END) return cjson_tape_missing;
+    return element;
+}
+
+JsonTapeRef json_tape_member_value(JsonTapeRef key){
+    if (!key.tape || CJSON_TAPE_TAG(cjson_tape_word(key)) != JSON_TAPE_KEY) return cjson_tape_missing;
+    key.index++;
+    return key;
+}
+
+// Bytes of a string or key, NUL-terminated and valid as long as the tape
+const char* json_tape_get_string(JsonTapeRef ref, size_t* length){
+    if (json_tape_type(ref) != JSON_STRING) return NULL;
+    const char* entry = ref.tape->strings + CJSON_TAPE_PAYLOAD(cjson_tape_word(ref));
+    uint32_t stored;
+    memcpy(&stored, entry, sizeof(stored));
+    if (length) *length = stored;
+    return entry + sizeof(stored);
+}
+
+JsonTapeRef json_tape_get_child(JsonTapeRef object, const char* key){
+    if (json_tape_type(object) != JSON_OBJECT) return cjson_tape_missing;
+    size_t key_length = strlen(key);
+    for (JsonTapeRef member = json_tape_first(object); member.tape; member = json_tape_next(member)) {
+        size_t length = 0;
+        const char* name = json_tape_get_string(member, &length);
+        if (length == key_length && memcmp(name, key, length) == 0) {
+            return json_tape_member_value(member);
+        }
+    }
+    return cjson_tape_missing;
+}
+
+JsonTapeRef json_tape_get_at(JsonTapeRef array, size_t index){
+    if (json_tape_type(array) != JSON_ARRAY) return cjson_tape_missing;
+    JsonTapeRef element = json_tape_first(array);
+    while (element.tape && index--) {
+        element = json_tape_next(element);
+    }
+    return element;
+}
+
+// Elements of an array, members of an object or bytes of a string; 0 otherwise
+size_t json_tape_length(JsonTapeRef ref){
+    switch (json_tape_type(ref)) {
+        case JSON_OBJECT:
+        case JSON_ARRAY: {
+            size_t count = (size_t)((cjson_tape_word(ref) >> 32) & CJSON_TAPE_MAX_COUNT);
+            if (count < CJSON_TAPE_MAX_COUNT) return count;
+            count = 0;
+            for (JsonTapeRef element = json_tape_first(ref); element.tape; element = json_tape_next(element)) {
+                count++;
+            }
+            return count;
+        }
+        case JSON_STRING: {
+            size_t length = 0;
+            json_tape_get_string(ref, &length);
+            return length;
+        }
+        default:
+            return 0;
+    }
+}
+
+double json_tape_get_number(JsonTapeRef ref){
+    if (json_tape_type(ref) != JSON_NUMBER) return 0;
+    uint64_t raw = ref.tape->words[ref.index + 1];
+    switch (CJSON_TAPE_TAG(cjson_tape_word(ref))) {
+        case JSON_TAPE_INT64: return (double)(int64_t)raw;
+        case JSON_TAPE_UINT64: return (double)raw;
+        default: {
+            double number;
+            memcpy(&number, &raw, sizeof(number));
+            return number;
+        }
+    }
+}
+
+// True when the number is an integer that fits in int64_t
+bool json_tape_get_int64(JsonTapeRef ref, int64_t* out){
+    if (json_tape_type(ref) != JSON_NUMBER) return false;
+    uint8_t tag = CJSON_TAPE_TAG(cjson_tape_word(ref));
+    if (tag == JSON_TAPE_INT64) {
+        *out = (int64_t)ref.tape->words[ref.index + 1];
+        return true;
+    }
+    if (tag == JSON_TAPE_UINT64) return false;
+    JsonValue number = { .number = json_tape_get_number(ref), .type = JSON_NUMBER, .flags = 0, .length = 0 };
+    return json_get_int64(&number, out);
+}
+
+bool json_tape_get_bool(JsonTapeRef ref){
+    return ref.tape && CJSON_TAPE_TAG(cjson_tape_word(ref)) == JSON_TAPE_TRUE;
+}
+
+// Rebuilds the value at ref as a regular tree, release it with json_free
+JsonValue* json_tape_to_value(JsonTapeRef ref){
+    if (!ref.tape) return NULL;
+    switch (CJSON_TAPE_TAG(cjson_tape_word(ref))) {
+        case JSON_TAPE_OBJECT: {
+            JsonValue* object = json_new_object();
+            CjsonKeyScratch seen = { NULL, 0 };
+            for (JsonTapeRef member = json_tape_first(ref); member.tape; member = json_tape_next(member)) {
+                size_t length = 0;
+                const char* key = json_tape_get_string(member, &length);
+                JsonValue* child = json_tape_to_value(json_tape_member_value(member));
+                if (!object->object) object->object = cjson_object_new(NULL);
+                ptrdiff_t existing = cjson_key_scratch_find(&seen, object->object, key);
+                if (existing >= 0) {
+                    // tapes keep repeated keys; the last value wins
+                    JsonPair* pair = &object->object->pairs[existing];
+                    json_free(pair->value);
+                    pair->value = child;
+                } else {
+                    char* copy = malloc(length + 1);
+                    memcpy(copy, key, length + 1);
+                    cjson_object_append(object->object, copy, child);
+                }
+            }
+            free(seen.slots);
+            return object;
+        }
+        case JSON_TAPE_ARRAY: {
+            JsonValue* array = json_new_array();
+            for (JsonTapeRef element = json_tape_first(ref); element.tape; element = json_tape_next(element)) {
+                arrput(array->array, json_tape_to_value(element));
+            }
+            return array;
+        }
+        case JSON_TAPE_KEY:
+        case JSON_TAPE_STRING: {
+            size_t length;
+            const char* str = json_tape_get_string(ref, &length);
+            return json_new_nstring(str, length);
+        }
+        case JSON_TAPE_INT64:
+            return json_new_int64((int64_t)ref.tape->words[ref.index + 1]);
+        case JSON_TAPE_UINT64:
+            return json_new_uint64(ref.tape->words[ref.index + 1]);
+        case JSON_TAPE_DOUBLE:
+            return json_new_number(json_tape_get_number(ref));
+        case JSON_TAPE_TRUE:
+            return json_new_bool(true);
+        case JSON_TAPE_FALSE:
+            return json_new_bool(false);
+        default:
+            return json_new_null();
+    }
+}
+
+// Tape snapshots: a tape written to a file as is, behind a small header, so
+// a later process can map it and query it in place through the json_tape_*
+// calls with nothing decoded or rebuilt. The mapping is shared and read
+// only, so every process opening the same snapshot shares its pages.
+// Snapshots are native-endian and trusted: opening one checks the header and
+// sizes, not the words themselves.
+#define CJSON_SNAPSHOT_MAGIC "CJSONTP1"
+#define CJSON_SNAPSHOT_ENDIAN 0x01020304u
+
+typedef struct {
+    char magic[8];
+    uint32_t endian;         // CJSON_SNAPSHOT_ENDIAN as written
+    uint32_t header_size;
+    uint64_t word_count;
+    uint64_t string_length;  // bytes of string entries, after the words
+} CjsonSnapshotHeader;
+
+bool json_tape_save(const JsonTape* tape, const char* file_name){
+    FILE* fp = fopen(file_name, "wb");
+    if (!fp) {
+        fprintf(stderr, "Could not write file\n");
+        return false;
+    }
+    CjsonSnapshotHeader header = { .endian = CJSON_SNAPSHOT_ENDIAN, .header_size = sizeof(header),
+                                   .word_count = tape->count };
+    memcpy(header.magic, CJSON_SNAPSHOT_MAGIC, sizeof(header.magic));
+    if (tape->snapshot) {
+        // an opened snapshot keeps its string length in its own header
+        CjsonSnapshotHeader source;
+        memcpy(&source, tape->snapshot, sizeof(source));
+        header.string_length = source.string_length;
+    } else {
+        header.string_length = arrlenu(tape->strings);
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(tape->words, sizeof(uint64_t), tape->count, fp) == tape->count &&
+              fwrite(tape->strings, 1, header.string_length, fp) == header.string_length;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok) fprintf(stderr, "Could not write entire file\n");
+    return ok;
+}
+
+// Opens a snapshot written by json_tape_save; release it with json_tape_free
+bool json_tape_open(const char* file_name, JsonTape* tape){
+    cjson_tape_init(tape);
+    char* data = NULL;
+    size_t length = 0;
+
+#if defined(CJSON_POSIX)
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not read file\n");
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = mapped;
+            length = (size_t)st.st_size;
+            tape->snapshot_length = length;
+        }
+    }
+    close(fd);
+#endif
+    if (!data) {
+        data = file_read(file_name);
+        if (!data) return false;
+        length = arrlenu(data) - 1;
+    }
+    tape->snapshot = data;
+
+    CjsonSnapshotHeader header;
+    if (length < sizeof(header)) {
+        fprintf(stderr, "Not a tape snapshot\n");
+        json_tape_free(tape);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    uint64_t available = length - sizeof(header);
+    if (memcmp(header.magic, CJSON_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.endian != CJSON_SNAPSHOT_ENDIAN || header.header_size != sizeof(header) ||
+        header.word_count > available / sizeof(uint64_t) ||
+        header.string_length != available - header.word_count * sizeof(uint64_t)) {
+        fprintf(stderr, "Not a tape snapshot for this build\n");
+        json_tape_free(tape);
+        return false;
+    }
+    tape->words = (uint64_t*)(data + sizeof(header));
+    tape->strings = data + sizeof(header) + header.word_count * sizeof(uint64_t);
+    tape->count = (size_t)header.word_count;
+    return true;
+}
+
+// Compiled paths: an RFC 6901 pointer ("/user/address/city", "/items/0") or
+// the dotted form ("user.address.city", "items[0].name") is parsed once into
+// decoded, pre-hashed segments and then evaluated against any number of
+// documents, either as a tree or straight over the raw text with the lazy
+// cursors. An empty expression selects the root.
+typedef struct {
+    char* key;          // decoded key, NUL-terminated; NULL for a dotted [n]
+    size_t length;
+    uint64_t hash;      // cjson_hash_bytes(key, length)
+    size_t index;       // array position, valid when has_index
+    bool has_index;
+} CjsonPathSegment;
+
+typedef struct {
+    CjsonPathSegment* segments; // stb_ds array
+} JsonPath;
+
+static bool cjson_path_fail(JsonError* error, size_t offset, const char* message){
+    if (error) {
+        error->code = JSON_ERROR_SYNTAX;
+        error->offset = offset;
+        error->message = message;
+    }
+    return false;
+}
+
+// Array position spelled the RFC 6901 way: digits, no sign, no leading zero
+static bool cjson_path_parse_index(const char* text, size_t length, size_t* out){
+    if (length == 0 || length > 19 || (length > 1 && text[0] == '0')) return false;
+    size_t value = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isdigit((unsigned char)text[i])) return false;
+        value = value * 10 + (size_t)(text[i] - '0');
+    }
+    *out = value;
+    return true;
+}
+
+static void cjson_path_push_key(JsonPath* path, char* key, size_t length){
+    CjsonPathSegment segment = { .key = key, .length = length, .hash = cjson_hash_bytes(key, length) };
+    segment.has_index = cjson_path_parse_index(key, length, &segment.index);
+    arrput(path->segments, segment);
+}
+
+void json_path_free(JsonPath* path){
+    for (size_t i = 0; i < arrlenu(path->segments); i++) {
+        free(path->segments[i].key);
+    }
+    arrfree(path->segments);
+}
+
+static bool cjson_path_compile_pointer(JsonPath* path, const char* expression, JsonError* error){
+    size_t i = 0;
+    while (expression[i] == '/') {
+        i++;
+        size_t end = i;
+        while (expression[end] && expression[end] != '/') end++;
+        char* key = malloc(end - i + 1);
+        size_t length = 0;
+        for (size_t j = i; j < end; j++) {
+            if (expression[j] != '~') {
+                key[length++] = expression[j];
+            } else if (expression[j + 1] == '0' || expression[j + 1] == '1') {
+                key[length++] = expression[++j] == '0' ? '~' : '/';
+            } else {
+                free(key);
+                return cjson_path_fail(error, j, "'~' must be followed by 0 or 1");
+            }
+        }
+        key[length] = '\0';
+        cjson_path_push_key(path, key, length);
+        i = end;
+    }
+    return true;
+}
+
+static bool cjson_path_compile_dotted(JsonPath* path, const char* expression, JsonError* error){
+    size_t i = 0;
+    while (expression[i]) {
+        if (expression[i] == '[') {
+            size_t end = i + 1;
+            while (isdigit((unsigned char)expression[end])) end++;
+            CjsonPathSegment segment = { .key = NULL, .has_index = true };
+            if (expression[end] != ']' || !cjson_path_parse_index(expression + i + 1, end - i - 1, &segment.index)) {
+                return cjson_path_fail(error, i, "expected array index in []");
+            }
+            arrput(path->segments, segment);
+            i = end + 1;
+        } else {
+            size_t end = i;
+            while (expression[end] && expression[end] != '.' && expression[end] != '[') end++;
+            if (end == i) return cjson_path_fail(error, i, "empty key");
+            char* key = malloc(end - i + 1);
+            memcpy(key, expression + i, end - i);
+            key[end - i] = '\0';
+            cjson_path_push_key(path, key, end - i);
+            i = end;
+        }
+        if (expression[i] == '.') {
+            i++;
+            if (!expression[i] || expression[i] == '.' || expression[i] == '[') return cjson_path_fail(error, i, "empty key");
+        } else if (expression[i] && expression[i] != '[') {
+            return cjson_path_fail(error, i, "expected '.' or '['");
+        }
+    }
+    return true;
+}
+
+// Expressions starting with '/' are pointers, anything else is dotted.
+// On failure path is left empty and error says where.
+bool json_path_compile(JsonPath* path, const char* expression, JsonError* error){
+    path->segments = NULL;
+    if (error) error->code = JSON_OK;
+    bool ok = expression[0] == '/' ? cjson_path_compile_pointer(path, expression, error)
+                                   : cjson_path_compile_dotted(path, expression, error);
+    if (!ok) json_path_free(path);
+    return ok;
+}
+
+// The value the path selects below root; NULL when any step is missing
+JsonValue* json_path_get(const JsonPath* path, JsonValue* root){
+    JsonValue* at = root;
+    for (size_t i = 0; at && i < arrlenu(path->segments); i++) {
+        const CjsonPathSegment* segment = &path->segments[i];
+        if (at->type == JSON_OBJECT && segment->key && at->object) {
+            JsonObject* object = at->object;
+            ptrdiff_t found = cjson_object_find_hashed(object, segment->key, segment->length,
+                                                       cjson_object_indexed(object) ? segment->hash : 0);
+            at = found >= 0 ? object->pairs[found].value : NULL;
+        } else if (at->type == JSON_ARRAY && segment->has_index) {
+            at = json_get_at(at, segment->index);
+        } else {
+            at = NULL;
+        }
+    }
+    return at;
+}
+
+// The same over the raw document; missing when any step is missing
+JsonLazy json_path_get_lazy(const JsonPath* path, JsonLazy root){
+    JsonLazy at = root;
+    for (size_t i = 0; at.doc && i < arrlenu(path->segments); i++) {
+        const CjsonPathSegment* segment = &path->segments[i];
+        JsonType type = json_lazy_type(at);
+        if (type == JSON_OBJECT && segment->key) {
+            // a repeated key resolves to its last member, as in the tree
+            JsonLazy found = cjson_lazy_missing;
+            for (JsonLazy member = json_lazy_first(at); member.doc; member = json_lazy_next(member)) {
+                if (json_lazy_string_equals(member, segment->key, segment->length)) found = member;
+            }
+            at = json_lazy_member_value(found);
+        } else if (type == JSON_ARRAY && segment->has_index) {
+            at = json_lazy_get_at(at, segment->index);
+        } else {
+            at = cjson_lazy_missing;
+        }
+    }
+    return at;
+}
 
-    JsonValue* json_string = malloc(sizeof(JsonValue));
-    if (json_string == NULL) {
-        fprintf(stderr, "Could not allocate memory for JsonValue\n");
-        return NULL;
+// Tree lookups are already direct, so a batch is one lookup per path
+void json_path_get_many(const JsonPath* paths, size_t count, JsonValue* root, JsonValue** results){
+    for (size_t i = 0; i < count; i++) {
+        results[i] = json_path_get(&paths[i], root);
     }
+}
 
-    json_string->type = JSON_STRING;
-    json_string->string = copy;
-    return json_string;
+// Walks the container at the cursor once for every path in active (indices
+// into paths) that has matched depth segments so far
+static void cjson_path_collect_lazy(const JsonPath* paths, const size_t* active, size_t active_count,
+                                    size_t depth, JsonLazy at, JsonLazy* results){
+    size_t* pending = malloc(active_count * sizeof(size_t));
+    size_t pending_count = 0;
+    for (size_t i = 0; i < active_count; i++) {
+        if (arrlenu(paths[active[i]].segments) == depth) results[active[i]] = at;
+        else pending[pending_count++] = active[i];
+    }
+
+    JsonType type = json_lazy_type(at);
+    if (pending_count == 0 || (type != JSON_OBJECT && type != JSON_ARRAY)) {
+        free(pending);
+        return;
+    }
+
+    size_t* matched = malloc(pending_count * sizeof(size_t));
+    if (type == JSON_OBJECT) {
+        // a repeated key resolves to its last member, as in the tree, so the
+        // whole object is walked before any path descends
+        JsonLazy* found = malloc(pending_count * sizeof(JsonLazy));
+        for (size_t i = 0; i < pending_count; i++) found[i] = cjson_lazy_missing;
+        for (JsonLazy member = json_lazy_first(at); member.doc; member = json_lazy_next(member)) {
+            for (size_t i = 0; i < pending_count; i++) {
+                const CjsonPathSegment* segment = &paths[pending[i]].segments[depth];
+                if (segment->key && json_lazy_string_equals(member, segment->key, segment->length)) found[i] = member;
+            }
+        }
+        // paths that landed on the same member descend together
+        for (size_t i = 0; i < pending_count; i++) {
+            JsonLazy member = found[i];
+            if (!member.doc) continue;
+            size_t matched_count = 0;
+            for (size_t j = i; j < pending_count; j++) {
+                if (found[j].doc && found[j].offset == member.offset) {
+                    matched[matched_count++] = pending[j];
+                    found[j] = cjson_lazy_missing;
+                }
+            }
+            cjson_path_collect_lazy(paths, matched, matched_count, depth + 1, json_lazy_member_value(member), results);
+        }
+        free(found);
+    } else {
+        size_t position = 0;
+        for (JsonLazy element = json_lazy_first(at); element.doc && pending_count > 0; element = json_lazy_next(element)) {
+            // a path leaves pending once its index is reached
+            size_t matched_count = 0;
+            for (size_t i = 0; i < pending_count; ) {
+                const CjsonPathSegment* segment = &paths[pending[i]].segments[depth];
+                if (segment->has_index && segment->index == position) {
+                    matched[matched_count++] = pending[i];
+                    pending[i] = pending[--pending_count];
+                } else {
+                    i++;
+                }
+            }
+            if (matched_count > 0) cjson_path_collect_lazy(paths, matched, matched_count, depth + 1, element, results);
+            position++;
+        }
+    }
+    free(matched);
+    free(pending);
 }
 
-// TODO: Remove arena
+// Evaluates count paths over the raw document in a single pass: each
+// container on the way is walked once for all paths that lead through it.
+// An array walk stops as soon as every path under it is resolved; an object
+// is walked to its end so a repeated key resolves to its last member
+void json_path_get_many_lazy(const JsonPath* paths, size_t count, JsonLazy root, JsonLazy* results){
+    size_t* active = malloc(count * sizeof(size_t));
+    for (size_t i = 0; i < count; i++) {
+        results[i] = cjson_lazy_missing;
+        active[i] = i;
+    }
+    if (root.doc && count > 0) cjson_path_collect_lazy(paths, active, count, 0, root, results);
+    free(active);
+}
 
-JsonValue* json_new_number(double num){
-    JsonValue* json_num = malloc(sizeof(JsonValue));
-    json_num->type = JSON_NUMBER;
-    json_num->number = num;
-    return json_num;
+// Struct binding: a JsonBinding lists the members of a C struct, and
+// json_bind_parse fills the struct straight from the parser's events while
+// json_bind_write serializes it, with no JsonValue tree in between.
+// Strings are malloc'd copies and arrays are stb_ds arrays (read them with
+// arrlenu); json_bind_free releases both. Members the binding doesn't name
+// are skipped, null leaves a field zeroed.
+//
+//     typedef struct { char* city; int zip; } Address;
+//     typedef struct { int64_t id; char* name; double* scores; Address home; } User;
+//
+//     static const JsonBinding address_binding = JSON_BINDING(Address,
+//         JSON_BIND_STRING(Address, city), JSON_BIND_INT(Address, zip));
+//     static const JsonBinding user_binding = JSON_BINDING(User,
+//         JSON_BIND_INT64(User, id), JSON_BIND_STRING(User, name),
+//         JSON_BIND_ARRAY(User, scores, JSON_FIELD_DOUBLE),
+//         JSON_BIND_STRUCT(User, home, address_binding));
+typedef enum {
+    JSON_FIELD_BOOL,    // bool
+    JSON_FIELD_INT,     // int
+    JSON_FIELD_INT64,   // int64_t
+    JSON_FIELD_DOUBLE,  // double
+    JSON_FIELD_STRING,  // char*, NUL-terminated
+    JSON_FIELD_STRUCT,  // struct embedded by value, described by its own binding
+    JSON_FIELD_ARRAY,   // stb_ds array of element; arrays of arrays are not supported
+} JsonFieldKind;
+
+typedef struct JsonBinding JsonBinding;
+
+typedef struct {
+    const char* name;           // JSON key
+    JsonFieldKind kind;
+    JsonFieldKind element;      // kind of the elements of a JSON_FIELD_ARRAY
+    size_t offset;
+    const JsonBinding* binding; // for JSON_FIELD_STRUCT and arrays of structs
+} JsonField;
+
+struct JsonBinding {
+    const JsonField* fields;
+    size_t count;
+    size_t size;                // sizeof the struct
+};
+
+#define JSON_BIND_FIELD(type, member, name, kind, element, binding) \
+    { name, kind, element, offsetof(type, member), binding }
+
+#define JSON_BIND_BOOL(type, member)   JSON_BIND_FIELD(type, member, #member, JSON_FIELD_BOOL, 0, NULL)
+#define JSON_BIND_INT(type, member)    JSON_BIND_FIELD(type, member, #member, JSON_FIELD_INT, 0, NULL)
+#define JSON_BIND_INT64(type, member)  JSON_BIND_FIELD(type, member, #member, JSON_FIELD_INT64, 0, NULL)
+#define JSON_BIND_DOUBLE(type, member) JSON_BIND_FIELD(type, member, #member, JSON_FIELD_DOUBLE, 0, NULL)
+#define JSON_BIND_STRING(type, member) JSON_BIND_FIELD(type, member, #member, JSON_FIELD_STRING, 0, NULL)
+#define JSON_BIND_STRUCT(type, member, binding) \
+    JSON_BIND_FIELD(type, member, #member, JSON_FIELD_STRUCT, 0, &(binding))
+#define JSON_BIND_ARRAY(type, member, element) \
+    JSON_BIND_FIELD(type, member, #member, JSON_FIELD_ARRAY, element, NULL)
+#define JSON_BIND_STRUCT_ARRAY(type, member, binding) \
+    JSON_BIND_FIELD(type, member, #member, JSON_FIELD_ARRAY, JSON_FIELD_STRUCT, &(binding))
+
+#define JSON_BINDING(type, ...) { (const JsonField[]){__VA_ARGS__}, \
+                                  sizeof((const JsonField[]){__VA_ARGS__}) / sizeof(JsonField), \
+                                  sizeof(type) }
+
+static size_t cjson_bind_size(JsonFieldKind kind, const JsonBinding* binding){
+    switch (kind) {
+        case JSON_FIELD_BOOL:   return sizeof(bool);
+        case JSON_FIELD_INT:    return sizeof(int);
+        case JSON_FIELD_INT64:  return sizeof(int64_t);
+        case JSON_FIELD_DOUBLE: return sizeof(double);
+        case JSON_FIELD_STRING: return sizeof(char*);
+        case JSON_FIELD_STRUCT: return binding->size;
+        default:                return sizeof(void*);
+    }
 }
 
-JsonValue* json_new_bool(bool value){
-    JsonValue* json_bool = malloc(sizeof(JsonValue));
-    json_bool->type = JSON_BOOL;
-    json_bool->boolean = value;
-    return json_bool;
+// String and array fields are read and written through memcpy, since the
+// field's real pointer type is only known to the caller
+static void* cjson_bind_load(const char* at){
+    void* pointer;
+    memcpy(&pointer, at, sizeof(pointer));
+    return pointer;
 }
 
-JsonValue* json_new_null(){
-    JsonValue* json_null = malloc(sizeof(JsonValue));
-    json_null->type = JSON_NULL;
-    return json_null;
+static void cjson_bind_store(char* at, void* pointer){
+    memcpy(at, &pointer, sizeof(pointer));
 }
 
-#define STR_ARR(...) (const char*[]){__VA_ARGS__}, \
-                     sizeof((const char*[]){__VA_ARGS__}) / sizeof(const char*)
+// Releases the strings and arrays inside value, not value itself
+void json_bind_free(const JsonBinding* binding, void* value){
+    for (size_t i = 0; i < binding->count; i++) {
+        const JsonField* field = &binding->fields[i];
+        char* at = (char*)value + field->offset;
+        if (field->kind == JSON_FIELD_STRING) {
+            free(cjson_bind_load(at));
+            cjson_bind_store(at, NULL);
+        } else if (field->kind == JSON_FIELD_STRUCT) {
+            json_bind_free(field->binding, at);
+        } else if (field->kind == JSON_FIELD_ARRAY) {
+            char* elements = cjson_bind_load(at);
+            size_t size = cjson_bind_size(field->element, field->binding);
+            for (size_t j = 0; j < arrlenu(elements); j++) {
+                if (field->element == JSON_FIELD_STRING) free(cjson_bind_load(elements + j * size));
+                else if (field->element == JSON_FIELD_STRUCT) json_bind_free(field->binding, elements + j * size);
+            }
+            arrfree(elements);
+            cjson_bind_store(at, NULL);
+        }
+    }
+}
 
-#define NUM_ARR(...) (double[]){__VA_ARGS__}, \
-                     sizeof((double[]){__VA_ARGS__}) / sizeof(double)
+typedef struct {
+    const JsonBinding* binding; // struct being filled, NULL while filling an array
+    char* base;                 // that struct
+    const JsonField* field;     // field the next value goes to; NULL skips the value
+    const JsonField* array;     // array field being filled
+    char* elements;             // where that array's stb_ds pointer lives
+} CjsonBindFrame;
 
+typedef struct {
+    CjsonBindFrame root;        // frame for the root object, binding NULL once opened
+    CjsonBindFrame* stack;
+    size_t skip_depth;          // > 0 inside a value no field wants
+    const char* error;          // set when a value doesn't fit its field
+} CjsonBinder;
+
+// Where the next value goes: its kind, storage and, for struct members,
+// its field. False when the value is to be skipped.
+static bool cjson_bind_target(CjsonBinder* binder, JsonFieldKind* kind, char** target, const JsonField** field){
+    if (binder->skip_depth > 0 || arrlenu(binder->stack) == 0) return false;
+    CjsonBindFrame* top = &arrlast(binder->stack);
+    if (top->binding) {
+        if (!top->field) return false;
+        *field = top->field;
+        *kind = top->field->kind;
+        *target = top->base + top->field->offset;
+        top->field = NULL;
+        return true;
+    }
+    size_t size = cjson_bind_size(top->array->element, top->array->binding);
+    char* elements = stbds_arrgrowf(cjson_bind_load(top->elements), size, 1, 0);
+    cjson_bind_store(top->elements, elements);
+    size_t count = stbds_header(elements)->length++;
+    *field = NULL;
+    *kind = top->array->element;
+    *target = elements + count * size;
+    memset(*target, 0, size);
+    return true;
+}
 
+static bool cjson_bind_mismatch(CjsonBinder* binder, const char* message){
+    binder->error = message;
+    return false;
+}
 
+static bool cjson_bind_start_object(void* context){
+    CjsonBinder* binder = context;
+    CjsonBindFrame frame = { 0 };
+    if (arrlenu(binder->stack) == 0 && !binder->skip_depth) {
+        frame = binder->root;
+        binder->root.binding = NULL;
+        if (!frame.binding) return cjson_bind_mismatch(binder, "only one root object can be bound");
+        arrput(binder->stack, frame);
+        return true;
+    }
+    JsonFieldKind kind;
+    char* target;
+    const JsonField* field;
+    if (!cjson_bind_target(binder, &kind, &target, &field)) {
+        binder->skip_depth++;
+        return true;
+    }
+    if (kind != JSON_FIELD_STRUCT) return cjson_bind_mismatch(binder, "object where the binding expects another type");
+    frame.binding = field ? field->binding : arrlast(binder->stack).array->binding;
+    frame.base = target;
+    if (field) {
+        // a repeated key keeps the last value, not a merge of both objects
+        json_bind_free(field->binding, target);
+        memset(target, 0, field->binding->size);
+    }
+    arrput(binder->stack, frame);
+    return true;
+}
 
-JsonValue* json_new_sarray(const char** items, size_t length){
-    JsonValue* json_array = malloc(sizeof(JsonValue));
-    json_array->type = JSON_ARRAY;
-    json_array->array = NULL;
-    for(size_t i = 0; i < length; i++){
-        const char* item = items[i];
-        JsonValue* json_string = json_new_string(item);
-        json_add_child(json_array, NULL, json_string);
+static bool cjson_bind_start_array(void* context){
+    CjsonBinder* binder = context;
+    if (arrlenu(binder->stack) == 0 && !binder->skip_depth) return cjson_bind_mismatch(binder, "root is not an object");
+    JsonFieldKind kind;
+    char* target;
+    const JsonField* field;
+    if (!cjson_bind_target(binder, &kind, &target, &field)) {
+        binder->skip_depth++;
+        return true;
     }
-    return json_array;
+    if (kind != JSON_FIELD_ARRAY || !field) return cjson_bind_mismatch(binder, "array where the binding expects another type");
+    if (cjson_bind_load(target)) {
+        // a repeated key keeps the last value
+        JsonBinding owner = { .fields = field, .count = 1 };
+        json_bind_free(&owner, target - field->offset);
+    }
+    CjsonBindFrame frame = { .array = field, .elements = target };
+    arrput(binder->stack, frame);
+    return true;
 }
 
-JsonValue* json_new_narray(const double* items, size_t length){
-    JsonValue* json_array = malloc(sizeof(JsonValue));
-    json_array->type = JSON_ARRAY;
-    json_array->array = NULL;
-    for(size_t i = 0; i < length; i++){
-        double item = items[i];
-        JsonValue* json_number = json_new_number(item);
-        json_add_child(json_array, NULL, json_number);
+static bool cjson_bind_end(void* context){
+    CjsonBinder* binder = context;
+    if (binder->skip_depth > 0) binder->skip_depth--;
+    else (void)arrpop(binder->stack);
+    return true;
+}
+
+static bool cjson_bind_key(void* context, const char* key, size_t length){
+    CjsonBinder* binder = context;
+    if (binder->skip_depth > 0) return true;
+    CjsonBindFrame* top = &arrlast(binder->stack);
+    top->field = NULL;
+    for (size_t i = 0; i < top->binding->count; i++) {
+        const JsonField* field = &top->binding->fields[i];
+        if (strlen(field->name) == length && memcmp(field->name, key, length) == 0) {
+            top->field = field;
+            break;
+        }
     }
-    return json_array;
+    return true;
 }
 
-JsonValue* json_new_object(){
-    JsonValue* json_object = malloc(sizeof(JsonValue));
-    json_object->type = JSON_OBJECT;
-    json_object->object = NULL;
-    return json_object;
+static bool cjson_bind_string(void* context, const char* str, size_t length){
+    CjsonBinder* binder = context;
+    JsonFieldKind kind;
+    char* target;
+    const JsonField* field;
+    if (!cjson_bind_target(binder, &kind, &target, &field)) return true;
+    if (kind != JSON_FIELD_STRING) return cjson_bind_mismatch(binder, "string where the binding expects another type");
+    char* copy = malloc(length + 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    free(cjson_bind_load(target)); // a repeated key keeps the last value
+    cjson_bind_store(target, copy);
+    return true;
 }
 
-JsonValue* json_new_array(){
-    JsonValue* json_array = malloc(sizeof(JsonValue));
-    json_array->type = JSON_ARRAY;
-    json_array->array = NULL;
-    return json_array;
+static bool cjson_bind_number(void* context, const JsonValue* number){
+    CjsonBinder* binder = context;
+    JsonFieldKind kind;
+    char* target;
+    const JsonField* field;
+    if (!cjson_bind_target(binder, &kind, &target, &field)) return true;
+    int64_t integer;
+    switch (kind) {
+        case JSON_FIELD_DOUBLE:
+            *(double*)target = json_get_number(number);
+            return true;
+        case JSON_FIELD_INT64:
+            if (!json_get_int64(number, &integer)) return cjson_bind_mismatch(binder, "number does not fit an int64_t field");
+            *(int64_t*)target = integer;
+            return true;
+        case JSON_FIELD_INT:
+            if (!json_get_int64(number, &integer) || integer < INT_MIN || integer > INT_MAX) {
+                return cjson_bind_mismatch(binder, "number does not fit an int field");
+            }
+            *(int*)target = (int)integer;
+            return true;
+        default:
+            return cjson_bind_mismatch(binder, "number where the binding expects another type");
+    }
+}
+
+static bool cjson_bind_boolean(void* context, bool value){
+    CjsonBinder* binder = context;
+    JsonFieldKind kind;
+    char* target;
+    const JsonField* field;
+    if (!cjson_bind_target(binder, &kind, &target, &field)) return true;
+    if (kind != JSON_FIELD_BOOL) return cjson_bind_mismatch(binder, "boolean where the binding expects another type");
+    *(bool*)target = value;
+    return true;
+}
+
+static bool cjson_bind_null(void* context){
+    CjsonBinder* binder = context;
+    JsonFieldKind kind;
+    char* target;
+    const JsonField* field;
+    // claims the slot, so an array element becomes a zeroed entry
+    cjson_bind_target(binder, &kind, &target, &field);
+    return true;
+}
+
+static const JsonSaxHandler cjson_bind_handler = {
+    .start_object = cjson_bind_start_object,
+    .end_object = cjson_bind_end,
+    .start_array = cjson_bind_start_array,
+    .end_array = cjson_bind_end,
+    .key = cjson_bind_key,
+    .string = cjson_bind_string,
+    .number = cjson_bind_number,
+    .boolean = cjson_bind_boolean,
+    .null = cjson_bind_null,
+};
+
+// Parses json (NUL-terminated, not modified) into out, a struct described
+// by binding. The struct is zeroed first; on failure it holds what was
+// bound before the error and still needs json_bind_free.
+bool json_bind_parse(char* json, const JsonBinding* binding, void* out, JsonError* error){
+    memset(out, 0, binding->size);
+    CjsonBinder binder = { 0 };
+    binder.root.binding = binding;
+    binder.root.base = out;
+    bool ok = json_sax_parse(json, &cjson_bind_handler, &binder, error);
+    if (!ok && binder.error && error) {
+        error->code = JSON_ERROR_TYPE;
+        error->message = binder.error;
+    } else if (ok && binder.root.binding) {
+        ok = false;
+        if (error) {
+            error->code = JSON_ERROR_TYPE;
+            error->offset = 0;
+            error->message = "root is not an object";
+        }
+    }
+    arrfree(binder.stack);
+    return ok;
+}
+
+static void cjson_bind_write_value(JsonWriter* writer, JsonFieldKind kind, const JsonField* field, const char* at);
+
+static void cjson_bind_write_struct(JsonWriter* writer, const JsonBinding* binding, const char* base){
+    cjson_writer_char(writer, '{');
+    for (size_t i = 0; i < binding->count; i++) {
+        const JsonField* field = &binding->fields[i];
+        if (i > 0) cjson_writer_char(writer, ',');
+        cjson_write_string(writer, field->name, strlen(field->name));
+        cjson_writer_char(writer, ':');
+        cjson_bind_write_value(writer, field->kind, field, base + field->offset);
+    }
+    cjson_writer_char(writer, '}');
+}
+
+static void cjson_bind_write_value(JsonWriter* writer, JsonFieldKind kind, const JsonField* field, const char* at){
+    JsonValue number = { .type = JSON_NUMBER };
+    switch (kind) {
+        case JSON_FIELD_BOOL:
+            if (*(const bool*)at) cjson_writer_literal(writer, "true");
+            else cjson_writer_literal(writer, "false");
+            break;
+        case JSON_FIELD_INT:
+            number.integer = *(const int*)at;
+            number.number = (double)number.integer;
+            number.flags = JSON_FLAG_INT64;
+            cjson_write_number(writer, &number);
+            break;
+        case JSON_FIELD_INT64:
+            number.integer = *(const int64_t*)at;
+            number.number = (double)number.integer;
+            number.flags = JSON_FLAG_INT64;
+            cjson_write_number(writer, &number);
+            break;
+        case JSON_FIELD_DOUBLE:
+            number.number = *(const double*)at;
+            cjson_write_number(writer, &number);
+            break;
+        case JSON_FIELD_STRING: {
+            const char* str = cjson_bind_load(at);
+            if (str) cjson_write_string(writer, str, strlen(str));
+            else cjson_writer_literal(writer, "null");
+            break;
+        }
+        case JSON_FIELD_STRUCT:
+            cjson_bind_write_struct(writer, field->binding, at);
+            break;
+        case JSON_FIELD_ARRAY: {
+            const char* elements = cjson_bind_load(at);
+            size_t size = cjson_bind_size(field->element, field->binding);
+            cjson_writer_char(writer, '[');
+            for (size_t i = 0; i < arrlenu(elements); i++) {
+                if (i > 0) cjson_writer_char(writer, ',');
+                cjson_bind_write_value(writer, field->element, field, elements + i * size);
+            }
+            cjson_writer_char(writer, ']');
+            break;
+        }
+    }
+}
+
+// Compact JSON for the struct at value; NULL strings come out as null
+void json_bind_write(JsonWriter* writer, const JsonBinding* binding, const void* value){
+    cjson_bind_write_struct(writer, binding, value);
+}
+
+// The same as a NUL-terminated string, release it with free
+char* json_bind_dump_string(const JsonBinding* binding, const void* value){
+    JsonWriter writer;
+    json_writer_init(&writer);
+    json_bind_write(&writer, binding, value);
+    return json_writer_take(&writer);
+}
+
+// CBOR (RFC 8949) for services that hand documents to each other. Trees are
+// written with definite lengths; text is transcoded straight from the
+// parser's events with indefinite-length arrays and maps, so no tree and no
+// counting pass is needed. The reader takes both forms, skips tags and maps
+// undefined to null. Integral doubles are written as CBOR integers and
+// others as float32 when that is exact, so a round trip gives back the
+// same JSON text.
+#ifndef CJSON_CBOR_MAX_DEPTH
+    #define CJSON_CBOR_MAX_DEPTH 1024
+#endif
+
+#define CJSON_CBOR_UNSIGNED 0
+#define CJSON_CBOR_NEGATIVE 1
+#define CJSON_CBOR_BYTES    2
+#define CJSON_CBOR_TEXT     3
+#define CJSON_CBOR_ARRAY    4
+#define CJSON_CBOR_MAP      5
+#define CJSON_CBOR_TAG      6
+#define CJSON_CBOR_SIMPLE   7
+#define CJSON_CBOR_BREAK    0xff
+
+// Major type and argument in the shortest form
+static void cjson_cbor_head(JsonWriter* writer, uint8_t major, uint64_t argument){
+    uint8_t* dst = (uint8_t*)cjson_writer_reserve(writer, 9);
+    size_t size;
+    if (argument < 24) {
+        dst[0] = (uint8_t)(major << 5 | argument);
+        writer->length += 1;
+        return;
+    } else if (argument <= UINT8_MAX) {
+        dst[0] = (uint8_t)(major << 5 | 24);
+        size = 1;
+    } else if (argument <= UINT16_MAX) {
+        dst[0] = (uint8_t)(major << 5 | 25);
+        size = 2;
+    } else if (argument <= UINT32_MAX) {
+        dst[0] = (uint8_t)(major << 5 | 26);
+        size = 4;
+    } else {
+        dst[0] = (uint8_t)(major << 5 | 27);
+        size = 8;
+    }
+    for (size_t i = 0; i < size; i++) {
+        dst[1 + i] = (uint8_t)(argument >> (8 * (size - 1 - i)));
+    }
+    writer->length += 1 + size;
+}
+
+static void cjson_cbor_write_number(JsonWriter* writer, const JsonValue* number){
+    if (number->flags & JSON_FLAG_UINT64) {
+        cjson_cbor_head(writer, CJSON_CBOR_UNSIGNED, number->uinteger);
+        return;
+    }
+    if (number->flags & JSON_FLAG_INT64) {
+        int64_t value = number->integer;
+        if (value >= 0) cjson_cbor_head(writer, CJSON_CBOR_UNSIGNED, (uint64_t)value);
+        else cjson_cbor_head(writer, CJSON_CBOR_NEGATIVE, (uint64_t)(-1 - value));
+        return;
+    }
+
+    double value = number->number;
+    // integral and inside +-2^63, where the conversion is exact
+    if (value == trunc(value) && fabs(value) < 9223372036854775808.0 && !(value == 0 && signbit(value))) {
+        int64_t integer = (int64_t)value;
+        if (integer >= 0) cjson_cbor_head(writer, CJSON_CBOR_UNSIGNED, (uint64_t)integer);
+        else cjson_cbor_head(writer, CJSON_CBOR_NEGATIVE, (uint64_t)(-1 - integer));
+        return;
+    }
+    uint8_t* dst = (uint8_t*)cjson_writer_reserve(writer, 9);
+    if (fabs(value) <= FLT_MAX && (double)(float)value == value) {
+        float narrow = (float)value;
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        dst[0] = CJSON_CBOR_SIMPLE << 5 | 26;
+        for (size_t i = 0; i < 4; i++) dst[1 + i] = (uint8_t)(bits >> (24 - 8 * i));
+        writer->length += 5;
+    } else {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        dst[0] = CJSON_CBOR_SIMPLE << 5 | 27;
+        for (size_t i = 0; i < 8; i++) dst[1 + i] = (uint8_t)(bits >> (56 - 8 * i));
+        writer->length += 9;
+    }
+}
+
+static void cjson_cbor_write_text(JsonWriter* writer, const char* str, size_t length){
+    cjson_cbor_head(writer, CJSON_CBOR_TEXT, length);
+    json_writer_append(writer, str, length);
+}
+
+static void cjson_cbor_write_simple(JsonWriter* writer, uint8_t value){
+    cjson_writer_char(writer, (char)(CJSON_CBOR_SIMPLE << 5 | value));
+}
+
+// Encodes a tree as one CBOR data item
+void json_cbor_write(JsonWriter* writer, const JsonValue* json){
+    switch (json->type) {
+        case JSON_OBJECT: {
+            size_t count = cjson_object_count(json->object);
+            cjson_cbor_head(writer, CJSON_CBOR_MAP, count);
+            for (size_t i = 0; i < count; i++) {
+                const JsonPair* pair = &json->object->pairs[i];
+                cjson_cbor_write_text(writer, pair->key, strlen(pair->key));
+                json_cbor_write(writer, pair->value);
+            }
+            break;
+        }
+        case JSON_ARRAY:
+            cjson_cbor_head(writer, CJSON_CBOR_ARRAY, arrlenu(json->array));
+            for (size_t i = 0; i < arrlenu(json->array); i++) {
+                json_cbor_write(writer, json->array[i]);
+            }
+            break;
+        case JSON_STRING:
+            cjson_cbor_write_text(writer, json->string, json_string_length(json));
+            break;
+        case JSON_NUMBER:
+            cjson_cbor_write_number(writer, json);
+            break;
+        case JSON_BOOL:
+            cjson_cbor_write_simple(writer, json->boolean ? 21 : 20);
+            break;
+        case JSON_NULL:
+            cjson_cbor_write_simple(writer, 22);
+            break;
+    }
+}
+
+static bool cjson_cbor_start_container(void* context, uint8_t major){
+    JsonWriter* writer = context;
+    cjson_writer_char(writer, (char)(major << 5 | 31));
+    return !writer->failed;
+}
+
+static bool cjson_cbor_start_object(void* context){ return cjson_cbor_start_container(context, CJSON_CBOR_MAP); }
+static bool cjson_cbor_start_array(void* context){ return cjson_cbor_start_container(context, CJSON_CBOR_ARRAY); }
+
+static bool cjson_cbor_end_container(void* context){
+    JsonWriter* writer = context;
+    cjson_writer_char(writer, (char)CJSON_CBOR_BREAK);
+    return !writer->failed;
+}
+
+static bool cjson_cbor_text(void* context, const char* str, size_t length){
+    cjson_cbor_write_text(context, str, length);
+    return !((JsonWriter*)context)->failed;
+}
+
+static bool cjson_cbor_number(void* context, const JsonValue* number){
+    cjson_cbor_write_number(context, number);
+    return !((JsonWriter*)context)->failed;
+}
+
+static bool cjson_cbor_boolean(void* context, bool value){
+    cjson_cbor_write_simple(context, value ? 21 : 20);
+    return !((JsonWriter*)context)->failed;
+}
+
+static bool cjson_cbor_null(void* context){
+    cjson_cbor_write_simple(context, 22);
+    return !((JsonWriter*)context)->failed;
+}
+
+static const JsonSaxHandler cjson_cbor_handler = {
+    .start_object = cjson_cbor_start_object,
+    .end_object = cjson_cbor_end_container,
+    .start_array = cjson_cbor_start_array,
+    .end_array = cjson_cbor_end_container,
+    .key = cjson_cbor_text,
+    .string = cjson_cbor_text,
+    .number = cjson_cbor_number,
+    .boolean = cjson_cbor_boolean,
+    .null = cjson_cbor_null,
+};
+
+// Transcodes JSON text (NUL-terminated, not modified) to CBOR without
+// building a tree. A failing sink stops it with JSON_ERROR_CANCELLED.
+bool json_cbor_from_text(char* json, JsonWriter* writer, JsonError* error){
+    return json_sax_parse(json, &cjson_cbor_handler, writer, error);
+}
+
+// Reads CBOR data items from a buffer one after another
+typedef struct {
+    const uint8_t* data;
+    size_t length;
+    size_t offset;      // start of the next item
+    JsonError error;    // why the last json_cbor_read failed
+} JsonCborReader;
+
+void json_cbor_reader_init(JsonCborReader* reader, const void* data, size_t length){
+    reader->data = data;
+    reader->length = length;
+    reader->offset = 0;
+    reader->error.code = JSON_OK;
+    reader->error.offset = 0;
+    reader->error.message = NULL;
+}
+
+static bool cjson_cbor_fail(JsonCborReader* reader, JsonErrorCode code, size_t offset, const char* message){
+    reader->error.code = code;
+    reader->error.offset = offset;
+    reader->error.message = message;
+    return false;
+}
+
+// Reads an initial byte and its argument; indefinite is set for the
+// indefinite-length forms, whose argument is meaningless
+static bool cjson_cbor_read_head(JsonCborReader* reader, size_t* at, uint8_t* major, uint8_t* info,
+                                 uint64_t* argument, bool* indefinite){
+    if (*at >= reader->length) return cjson_cbor_fail(reader, JSON_ERROR_INCOMPLETE, *at, "unexpected end of input");
+    uint8_t initial = reader->data[(*at)++];
+    *major = initial >> 5;
+    *info = initial & 0x1f;
+    *indefinite = false;
+    if (*info < 24) {
+        *argument = *info;
+        return true;
+    }
+    if (*info == 31) {
+        *indefinite = true;
+        return true;
+    }
+    if (*info > 27) return cjson_cbor_fail(reader, JSON_ERROR_SYNTAX, *at - 1, "reserved additional information");
+    size_t size = (size_t)1 << (*info - 24);
+    if (reader->length - *at < size) return cjson_cbor_fail(reader, JSON_ERROR_INCOMPLETE, *at, "unexpected end of input");
+    *argument = 0;
+    for (size_t i = 0; i < size; i++) {
+        *argument = *argument << 8 | reader->data[*at + i];
+    }
+    *at += size;
+    return true;
+}
+
+static double cjson_cbor_half(uint16_t half){
+    int exponent = (half >> 10) & 0x1f;
+    double mantissa = half & 0x3ff;
+    double value;
+    if (exponent == 0) value = ldexp(mantissa, -24);
+    else if (exponent != 31) value = ldexp(mantissa + 1024, exponent - 25);
+    else value = mantissa == 0 ? INFINITY : NAN;
+    return (half & 0x8000) ? -value : value;
+}
+
+static bool cjson_cbor_is_break(const JsonCborReader* reader, size_t at){
+    return at < reader->length && reader->data[at] == CJSON_CBOR_BREAK;
+}
+
+// Text string, either definite or a run of definite chunks, as a malloc'd
+// NUL-terminated copy
+static bool cjson_cbor_read_text(JsonCborReader* reader, size_t* at, uint64_t argument, bool indefinite,
+                                 char** out, size_t* out_length){
+    char* text = NULL;
+    if (!indefinite) {
+        if (argument > reader->length - *at) return cjson_cbor_fail(reader, JSON_ERROR_INCOMPLETE, *at, "unexpected end of input");
+        memcpy(arraddnptr(text, (size_t)argument), reader->data + *at, (size_t)argument);
+        *at += (size_t)argument;
+    } else {
+        while (!cjson_cbor_is_break(reader, *at)) {
+            uint8_t major, info;
+            uint64_t length;
+            bool nested;
+            size_t chunk = *at;
+            if (!cjson_cbor_read_head(reader, at, &major, &info, &length, &nested)) {
+                arrfree(text);
+                return false;
+            }
+            if (major != CJSON_CBOR_TEXT || nested) {
+                arrfree(text);
+                return cjson_cbor_fail(reader, JSON_ERROR_SYNTAX, chunk, "bad chunk in indefinite-length string");
+            }
+            if (length > reader->length - *at) {
+                arrfree(text);
+                return cjson_cbor_fail(reader, JSON_ERROR_INCOMPLETE, *at, "unexpected end of input");
+            }
+            memcpy(arraddnptr(text, (size_t)length), reader->data + *at, (size_t)length);
+            *at += (size_t)length;
+        }
+        (*at)++; // the break
+    }
+    *out_length = arrlenu(text);
+    char* copy = malloc(*out_length + 1);
+    if (*out_length) memcpy(copy, text, *out_length);
+    copy[*out_length] = '\0';
+    arrfree(text);
+    *out = copy;
+    return true;
+}
+
+static bool cjson_cbor_read_item(JsonCborReader* reader, size_t* at, JsonValue* out, size_t depth){
+    out->flags = 0;
+    out->length = 0;
+    out->type = JSON_NULL;
+    if (depth > CJSON_CBOR_MAX_DEPTH) return cjson_cbor_fail(reader, JSON_ERROR_DEPTH, *at, "nesting too deep");
+
+    size_t start = *at;
+    uint8_t major, info;
+    uint64_t argument;
+    bool indefinite;
+    if (!cjson_cbor_read_head(reader, at, &major, &info, &argument, &indefinite)) return false;
+    if (indefinite && (major == CJSON_CBOR_UNSIGNED || major == CJSON_CBOR_NEGATIVE || major == CJSON_CBOR_TAG)) {
+        return cjson_cbor_fail(reader, JSON_ERROR_SYNTAX, start, "indefinite length on a type without one");
+    }
+
+    switch (major) {
+        case CJSON_CBOR_UNSIGNED:
+            out->type = JSON_NUMBER;
+            if (argument <= (1ULL << 53)) {
+                out->number = (double)argument;
+            } else if (argument <= INT64_MAX) {
+                out->integer = (int64_t)argument;
+                out->number = (double)argument;
+                out->flags = JSON_FLAG_INT64;
+            } else {
+                out->uinteger = argument;
+                out->number = (double)argument;
+                out->flags = JSON_FLAG_UINT64;
+            }
+            return true;
+        case CJSON_CBOR_NEGATIVE:
+            out->type = JSON_NUMBER;
+            if (argument < (1ULL << 53)) {
+                out->number = -1.0 - (double)argument;
+            } else if (argument <= INT64_MAX) {
+                out->integer = -1 - (int64_t)argument;
+                out->number = -1.0 - (double)argument;
+                out->flags = JSON_FLAG_INT64;
+            } else {
+                out->number = -1.0 - (double)argument;
+            }
+            return true;
+        case CJSON_CBOR_BYTES:
+            return cjson_cbor_fail(reader, JSON_ERROR_TYPE, start, "byte strings have no JSON form");
+        case CJSON_CBOR_TEXT: {
+            size_t length;
+            if (!cjson_cbor_read_text(reader, at, argument, indefinite, &out->string, &length)) return false;
+            out->type = JSON_STRING;
+            out->length = cjson_string_length_field(length);
+            return true;
+        }
+        case CJSON_CBOR_ARRAY:
+            out->type = JSON_ARRAY;
+            out->array = NULL;
+            for (uint64_t i = 0; indefinite ? !cjson_cbor_is_break(reader, *at) : i < argument; i++) {
+                JsonValue* element = malloc(sizeof(JsonValue));
+                arrput(out->array, element);
+                if (!cjson_cbor_read_item(reader, at, element, depth + 1)) return false;
+            }
+            if (indefinite) (*at)++;
+            return true;
+        case CJSON_CBOR_MAP: {
+            out->type = JSON_OBJECT;
+            out->object = NULL;
+            CjsonKeyScratch seen = { NULL, 0 };
+            bool ok = true;
+            for (uint64_t i = 0; indefinite ? !cjson_cbor_is_break(reader, *at) : i < argument; i++) {
+                size_t key_start = *at;
+                uint64_t key_length;
+                bool key_indefinite;
+                char* key;
+                size_t length;
+                if (!cjson_cbor_read_head(reader, at, &major, &info, &key_length, &key_indefinite)) {
+                    ok = false;
+                    break;
+                }
+                if (major != CJSON_CBOR_TEXT) {
+                    ok = cjson_cbor_fail(reader, JSON_ERROR_TYPE, key_start, "map key is not a text string");
+                    break;
+                }
+                if (!cjson_cbor_read_text(reader, at, key_length, key_indefinite, &key, &length)) {
+                    ok = false;
+                    break;
+                }
+
+                JsonValue* value = malloc(sizeof(JsonValue));
+                value->type = JSON_NULL;
+                value->flags = 0;
+                if (!out->object) out->object = cjson_object_new(NULL);
+                ptrdiff_t existing = cjson_key_scratch_find(&seen, out->object, key);
+                if (existing >= 0) {
+                    // a repeated key keeps the last value
+                    json_free(out->object->pairs[existing].value);
+                    out->object->pairs[existing].value = value;
+                    free(key);
+                } else {
+                    cjson_object_append(out->object, key, value);
+                }
+                if (!cjson_cbor_read_item(reader, at, value, depth + 1)) {
+                    ok = false;
+                    break;
+                }
+            }
+            free(seen.slots);
+            if (!ok) return false;
+            if (indefinite) (*at)++;
+            return true;
+        }
+        case CJSON_CBOR_TAG:
+            // the tagged item stands for itself
+            return cjson_cbor_read_item(reader, at, out, depth + 1);
+        default:
+            if (indefinite) return cjson_cbor_fail(reader, JSON_ERROR_SYNTAX, start, "unexpected break");
+            if (info == 20 || info == 21) {
+                out->type = JSON_BOOL;
+                out->boolean = info == 21;
+            } else if (info == 25 || info == 26 || info == 27) {
+                out->type = JSON_NUMBER;
+                if (info == 25) {
+                    out->number = cjson_cbor_half((uint16_t)argument);
+                } else if (info == 26) {
+                    uint32_t bits = (uint32_t)argument;
+                    float narrow;
+                    memcpy(&narrow, &bits, sizeof(narrow));
+                    out->number = narrow;
+                } else {
+                    memcpy(&out->number, &argument, sizeof(out->number));
+                }
+                if (!isfinite(out->number)) {
+                    out->type = JSON_NULL;
+                    return cjson_cbor_fail(reader, JSON_ERROR_NUMBER, start, "NaN and infinity have no JSON form");
+                }
+            } else if (info != 22 && info != 23) {
+                return cjson_cbor_fail(reader, JSON_ERROR_TYPE, start, "simple value has no JSON form");
+            }
+            return true;
+    }
+}
+
+// Decodes the next data item into output and moves past it. False at the
+// end of the buffer (error code JSON_OK) or on malformed input, with
+// reader->error set; output then holds nothing that needs freeing.
+bool json_cbor_read(JsonCborReader* reader, JsonValue* output){
+    reader->error.code = JSON_OK;
+    if (reader->offset >= reader->length) return false;
+    size_t at = reader->offset;
+    if (!cjson_cbor_read_item(reader, &at, output, 0)) {
+        cjson_free_contents(output);
+        output->type = JSON_NULL;
+        return false;
+    }
+    reader->offset = at;
+    return true;
 }
 
 #endif
\ No newline at end of file